@@ -0,0 +1,53 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+/**
+ * @brief The AllocationTracker class counts the heap allocations made through operator new by a thread, between start
+ * and stop, and keeps the backtraces of the first ones. It checks that the steady state of a control loop does not
+ * allocate. The hook replaces the global operator new of the process; it only costs a thread-local test while the
+ * thread is not tracked. The tracker itself never allocates.
+ *
+ * It is built as the static library allocationtracker, linked only into the executables which track their allocations,
+ * so that the shared library can be loaded with dlopen and leaves the allocator of the other programs alone.
+ */
+class AllocationTracker
+{
+public:
+	static const unsigned int MAX_RECORDS = 16;     // Allocations of an iteration whose backtrace is kept
+	static const unsigned int MAX_FRAMES = 24;      // Depth of a backtrace
+
+	/**
+	 * @brief start Count the allocations of the calling thread from now on, forgetting the previous ones
+	 */
+	static void start();
+
+	/**
+	 * @brief stop Stop counting the allocations of the calling thread
+	 * @return the number of allocations since start
+	 */
+	static unsigned long stop();
+
+	/**
+	 * @brief getCount Get the number of allocations of the calling thread since start
+	 */
+	static unsigned long getCount();
+
+	/**
+	 * @brief getBytes Get the number of bytes allocated by the calling thread since start
+	 */
+	static unsigned long getBytes();
+
+	/**
+	 * @brief report Write the size and the backtrace of the recorded allocations of the calling thread
+	 * @param fd File descriptor to write to
+	 */
+	static void report(int fd);
+
+	/**
+	 * @brief record Called by operator new for each allocation
+	 * @param size Size of the allocation
+	 */
+	static void record(unsigned long size);
+};
+
+#endif // ALLOCATIONTRACKER_H
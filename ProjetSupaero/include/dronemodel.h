@@ -0,0 +1,96 @@
+#ifndef DRONEMODEL_H
+#define DRONEMODEL_H
+
+#include <cmath>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+/**
+ * @brief The DroneModel namespace holds the constants of the quadrotor model, shared by the solver and the
+ * other blocks of the loop, and a C++ version of the dynamics written for ACADO in MPCSolver.
+ */
+namespace DroneModel
+{
+	const double c  = 0.00001;          // Drag coefficient of the propellers
+	const double Cf = 0.00065;          // Thrust coefficient of the propellers
+	const double d  = 0.250;            // Distance between the propellers and the center of the drone
+	const double Jx = 0.018;            // Inertia around x
+	const double Jy = 0.018;            // Inertia around y
+	const double Jz = 0.026;            // Inertia around z
+	const double m  = 0.9;              // Mass
+	const double g  = 9.81;             // Gravity
+
+	/**
+	 * @brief hoverSpeed Velocity of each propeller to keep the drone still
+	 * @return the trim velocity
+	 */
+	inline double hoverSpeed()
+	{
+		return std::sqrt(m*g/(4.*Cf));
+	}
+
+	typedef Eigen::Matrix<double,12,1> State;          // x,y,z, vx,vy,vz, phi,theta,psi, p,q,r
+	typedef Eigen::Matrix<double,4,1> Command;         // u1,u2,u3,u4
+	typedef Eigen::Matrix<double,13,1> QuaternionState; // x,y,z, vx,vy,vz, qw,qx,qy,qz, p,q,r
+	typedef Eigen::Matrix<double,12,12> StateMatrix;
+	typedef Eigen::Matrix<double,12,4> CommandMatrix;
+
+	/**
+	 * @brief dynamics Computes the derivative of the state
+	 * @param x State of the drone
+	 * @param u Velocity of the propellers
+	 * @return the derivative of the state
+	 */
+	State dynamics(const State &x, const Command &u);
+
+	/**
+	 * @brief integrate Integrates the dynamics over dt with a fourth order Runge-Kutta step, the command being constant
+	 * @param x State of the drone
+	 * @param u Velocity of the propellers
+	 * @param dt Time step
+	 * @return the state after dt
+	 */
+	State integrate(const State &x, const Command &u, double dt);
+
+	/**
+	 * @brief linearise Computes the Jacobians of the dynamics by central differences
+	 * @param x State of the drone
+	 * @param u Velocity of the propellers
+	 * @param A Jacobian with respect to the state
+	 * @param B Jacobian with respect to the command
+	 */
+	void linearise(const State &x, const Command &u, StateMatrix &A, CommandMatrix &B);
+
+	/**
+	 * @brief attitude Computes the orientation of the drone from its Euler angles. The rotation from the body frame to the
+	 * world frame is Rx(psi)*Ry(theta)*Rz(phi).
+	 * @param phi
+	 * @param theta
+	 * @param psi
+	 * @return the quaternion of the rotation
+	 */
+	Eigen::Quaterniond attitude(double phi, double theta, double psi);
+
+	/**
+	 * @brief eulerAngles Computes the Euler angles of an orientation, inverse of attitude()
+	 * @param q Quaternion of the rotation from the body frame to the world frame
+	 * @return phi, theta and psi
+	 */
+	Eigen::Vector3d eulerAngles(const Eigen::Quaterniond &q);
+
+	/**
+	 * @brief toQuaternionState Converts a state with Euler angles to a state with a quaternion
+	 * @param x State with Euler angles
+	 * @return the state with a quaternion
+	 */
+	QuaternionState toQuaternionState(const State &x);
+
+	/**
+	 * @brief toEulerState Converts a state with a quaternion to a state with Euler angles
+	 * @param x State with a quaternion, which does not need to be normalised
+	 * @return the state with Euler angles
+	 */
+	State toEulerState(const QuaternionState &x);
+}
+
+#endif // DRONEMODEL_H
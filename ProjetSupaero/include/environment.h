@@ -0,0 +1,88 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <memory>
+#include <vector>
+#include "environmentparser.h"
+
+/**
+ * @brief The Eshape struct holds the geometry of a cylinder derived from its bases at time 0. It is computed once,
+ * since the cylinders only translate.
+ */
+struct Eshape
+{
+	Epoint center;                          // Middle of the axis
+	Epoint axis;                            // Unit vector from the first base to the second
+	float length;                           // Distance between the bases
+	float orientation[4];                   // Quaternion (w,x,y,z) rotating the z axis onto the axis
+	Epoint min, max;                        // Bounding box
+};
+
+/**
+ * @brief The Eobstacle struct is a cylinder of an Environment with its derived geometry. It is immutable, and shared by
+ * the subsystems which use it through an ObstaclePtr.
+ */
+struct Eobstacle
+{
+	/**
+	 * @brief Eobstacle Computes the geometry of a cylinder
+	 * @param cylinder Cylinder, moved into the obstacle
+	 */
+	explicit Eobstacle(Ecylinder &&cylinder);
+
+	const Ecylinder cylinder;
+	const Eshape shape;
+};
+
+typedef std::shared_ptr<const Eobstacle> ObstaclePtr;
+
+class Environment;
+typedef std::shared_ptr<const Environment> EnvironmentPtr;
+
+/**
+ * @brief The Environment class is an immutable set of obstacles, sorted by id. It is built once from the parsed cylinders
+ * and shared by the parser, the viewer, the solver and the watchers: they keep pointers to its obstacles instead of
+ * copies of the cylinders. Each obstacle is allocated on its own, so that a subsystem which keeps some obstacles of an
+ * older version of the environment does not keep the others.
+ */
+class Environment
+{
+public:
+	/**
+	 * @brief create Build an environment
+	 * @param cylinders Cylinders, moved into the obstacles. Their ids must be unique.
+	 * @return the environment
+	 */
+	static EnvironmentPtr create(std::vector<Ecylinder> cylinders);
+
+	/**
+	 * @brief getObstacles Get the obstacles
+	 * @return the obstacles, sorted by id
+	 */
+	const std::vector<ObstaclePtr> &getObstacles() const;
+
+	/**
+	 * @brief size Number of obstacles
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief find Look an obstacle up by id
+	 * @param id Id of the cylinder
+	 * @return the obstacle, empty if there is none with this id
+	 */
+	ObstaclePtr find(unsigned int id) const;
+
+	/**
+	 * @brief memoryUsage Estimate the memory held by the environment, with the keyframes and the allocation overhead
+	 * @return a number of bytes
+	 */
+	size_t memoryUsage() const;
+
+private:
+	Environment(std::vector<ObstaclePtr> &&obstacles);
+
+	std::vector<ObstaclePtr> obstacles;
+};
+
+#endif // ENVIRONMENT_H
@@ -9,25 +9,62 @@ Description: Used to write or read an xml environment file
 #ifndef ENVIRONMENTPARSER_H
 #define ENVIRONMENTPARSER_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <tinyxml2.h>
 
+class Environment;
+
 /**
- * @brief The Ecylinder struct describes a cylinder as two circular bases which centers coordinates
- * are (x1,y1,z1) and (x2,y2,z2) respectively, as well as a radius.
+ * @brief The Epoint struct describes a point in cartesian spatial coordinates.
  */
-struct Ecylinder
+struct Epoint
 {
-	float x1, x2, y1, y2, z1, z2, radius;
+	float x, y, z;
 };
 
 /**
- * @brief The Epoint struct describes a point in cartesian spatial coordinates.
+ * @brief The Ekeyframe struct describes the displacement (x,y,z) of a moving cylinder at time t.
  */
-struct Epoint
+struct Ekeyframe
 {
-	float x, y, z;
+	float t, x, y, z;
+};
+
+/**
+ * @brief The Ecylinder struct describes a cylinder as two circular bases which centers coordinates
+ * are (x1,y1,z1) and (x2,y2,z2) respectively at time 0, as well as a radius. The id identifies the cylinder
+ * across reloads of the environment file.
+ * A cylinder moves either at a constant velocity (vx,vy,vz), or along a keyframed trajectory which is
+ * linearly interpolated and played in a loop. Keyframes take precedence over the velocity.
+ */
+struct Ecylinder
+{
+	unsigned int id;
+	float x1, x2, y1, y2, z1, z2, radius;
+	float vx, vy, vz;
+	std::vector<Ekeyframe> keyframes;
+
+	/**
+	 * @brief isStatic Tells if the cylinder never moves
+	 * @return true for a static cylinder
+	 */
+	bool isStatic() const;
+
+	/**
+	 * @brief displacement Get the translation of the cylinder at a given time, relative to its bases
+	 * @param t Time in seconds
+	 * @return the translation
+	 */
+	Epoint displacement(double t) const;
+
+	/**
+	 * @brief velocity Get the velocity of the cylinder at a given time
+	 * @param t Time in seconds
+	 * @return the velocity
+	 */
+	Epoint velocity(double t) const;
 };
 
 /**
@@ -56,24 +93,52 @@ public:
 	 */
 	void addCylinder(Epoint center1, Epoint center2, float radius);
 
+	/**
+	 * @brief addCylinder Manually add a cylinder that is not in the XML file, including its motion
+	 * @param cylinder Cylinder to add
+	 */
+	void addCylinder(const Ecylinder &cylinder);
+
 	/**
 	 * @brief save Save cylinders in memory to an XML document (useful if addCylinder was called)
 	 * @param name Filename to save to
 	 */
 	void save(std::string name);
 
+	/**
+	 * @brief write Save a list of cylinders directly to an XML document, without building it in memory.
+	 * Use it instead of addCylinder and save for large environments.
+	 * @param name Filename to save to
+	 * @param cylinders Cylinders to save
+	 * @return true if the file was written
+	 */
+	static bool write(const std::string &name, const std::vector<Ecylinder> &cylinders);
+
 	/**
 	 * @brief readData Parse the loaded XML file to a vector of Ecylinder
 	 * @return std::vector of Ecylinder
 	 */
 	std::vector<Ecylinder> readData();
 
+	/**
+	 * @brief readEnvironment Parse the loaded XML file to an Environment shared by the subsystems. The document is
+	 * released once parsed, so the parser no longer holds a copy of the cylinders.
+	 * @return the environment, empty if the document was not loaded
+	 */
+	std::shared_ptr<const Environment> readEnvironment();
+
 	/**
 	 * @brief getNbElements Get the number of cylinders in XML file and memory (from addCylinder)
 	 * @return Number of cylinders
 	 */
 	int getNbElements();
 
+	/**
+	 * @brief isLoaded Tells if the XML document was successfully loaded
+	 * @return true if the document can be parsed
+	 */
+	bool isLoaded();
+
 
 private:
 	int nbElements;                         // Number of elements
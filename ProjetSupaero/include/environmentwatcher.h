@@ -0,0 +1,71 @@
+#ifndef ENVIRONMENTWATCHER_H
+#define ENVIRONMENTWATCHER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "environment.h"
+
+/**
+ * @brief The EnvironmentDelta struct describes the changes between two versions of an environment.
+ * A modified cylinder appears both in removed (old version) and in added (new version).
+ */
+struct EnvironmentDelta
+{
+	std::vector<ObstaclePtr> added;         // New cylinders
+	std::vector<unsigned int> removed;      // Ids of the removed cylinders
+};
+
+/**
+ * @brief The EnvironmentWatcher class watches an XML environment file with inotify. Each time the file is written,
+ * a background thread parses it again and compares its cylinders with the ones already applied, by id.
+ * The main loop gets the resulting changes with pollDelta().
+ */
+class EnvironmentWatcher
+{
+public:
+	/**
+	 * @brief EnvironmentWatcher Starts watching the file
+	 * @param filename Filename of the XML doc to watch
+	 * @param environment Environment already loaded from the file
+	 */
+	EnvironmentWatcher(const std::string &filename, const EnvironmentPtr &environment);
+
+	/**
+	 * @brief ~EnvironmentWatcher Stops the background thread
+	 */
+	~EnvironmentWatcher();
+
+	/**
+	 * @brief pollDelta Get the changes since the last call, without blocking. The changes are considered applied.
+	 * @param delta Cylinders added and removed
+	 * @return true if the environment changed
+	 */
+	bool pollDelta(EnvironmentDelta &delta);
+
+private:
+	/**
+	 * @brief run Loop of the background thread, waits for inotify events and reloads the file
+	 */
+	void run();
+
+	/**
+	 * @brief reload Parse the file and compute the changes with the applied cylinders
+	 */
+	void reload();
+
+	std::string directory;                          // Directory of the file, which is the one watched
+	std::string basename;                           // Name of the file in the directory
+	EnvironmentPtr applied;                         // Environment as seen by the main loop
+	EnvironmentPtr latest;                          // Last version of the file
+	EnvironmentDelta pending;                       // Changes between applied and latest
+	bool hasPending;
+	std::mutex mutex;                               // Protects applied, latest, pending and hasPending
+	std::atomic<bool> running;
+	int inotifyFd;
+	std::thread thread;
+};
+
+#endif // ENVIRONMENTWATCHER_H
@@ -0,0 +1,113 @@
+#ifndef EVENTTRIGGEREDMPC_H
+#define EVENTTRIGGEREDMPC_H
+
+#include <array>
+#include "mpcsolver.h"
+
+/**
+ * @brief The TriggerParameters struct gathers the thresholds which make the EventTriggeredMPC solve again
+ */
+struct TriggerParameters
+{
+	/**
+	 * @brief TriggerParameters Default thresholds, for a flight at a few m/s
+	 */
+	TriggerParameters();
+
+	double positionTolerance;               // Distance between the measured and the predicted position
+	double velocityTolerance;               // Difference between the measured and the predicted velocity
+	double attitudeTolerance;               // Largest difference on the attitude variables (angles or quaternion)
+	double rateTolerance;                   // Largest difference on the angular velocity
+	double referenceTolerance;              // Change of the speed reference since the last solve
+	double obstacleDistance;                // Below this distance to an obstacle, the MPC solves at every step
+	double maxPlayback;                     // Longest time the stored controls are played, in seconds
+};
+
+/**
+ * @brief The Trigger enum is the reason of a solve, NONE when the step played the stored controls back
+ */
+enum class Trigger
+{
+	NONE, START, DEVIATION, REFERENCE, OBSTACLE, EXPIRED, FAILED
+};
+
+/**
+ * @brief The TriggerStatistics struct counts the steps of an EventTriggeredMPC, and the solves by reason
+ */
+struct TriggerStatistics
+{
+	static const unsigned int NB_TRIGGERS = 7;
+
+	unsigned long nbSteps;
+	unsigned long nbSolves;
+	std::array<unsigned long,NB_TRIGGERS> triggers;     // Number of steps for each Trigger, NONE counts the playbacks
+};
+
+/**
+ * @brief The EventTriggeredMPC class runs an MPCSolver only when its last prediction is no longer valid. It keeps the
+ * trajectory optimised by the last solve, and at each step compares the state to the predicted one and the speed
+ * reference to the one of the solve. The MPC solves again when they differ by more than a threshold, when the drone is
+ * close to an obstacle, or when the playback reaches its maximum length. Otherwise the step plays the predicted
+ * controls back.
+ */
+class EventTriggeredMPC
+{
+public:
+	/**
+	 * @brief EventTriggeredMPC
+	 * @param mpc Solver to run, its reference and obstacles are set directly on it
+	 * @param parameters Thresholds of the triggers
+	 */
+	EventTriggeredMPC(MPCSolver &mpc, const TriggerParameters &parameters = TriggerParameters());
+
+	/**
+	 * @brief step Solve or play the stored trajectory back
+	 * @param t Current time
+	 * @param x Current state of the drone
+	 * @return false if the MPC had to solve and failed
+	 */
+	bool step(double t, const ACADO::DVector &x);
+
+	/**
+	 * @brief getU Get the command of the last step
+	 * @param u Command, as given by MPCSolver::getU
+	 */
+	void getU(ACADO::DVector &u) const;
+
+	/**
+	 * @brief invalidate Make the next step solve, e.g. after the environment changed
+	 */
+	void invalidate();
+
+	/**
+	 * @brief getLastTrigger Get the reason of the last step
+	 * @return the reason of the solve, NONE if the stored controls were played back
+	 */
+	Trigger getLastTrigger() const;
+
+	const TriggerStatistics &getStatistics() const;
+	const TriggerParameters &getParameters() const;
+
+private:
+	/**
+	 * @brief check Compare the current situation with the prediction of the last solve
+	 * @param t Current time
+	 * @param x Current state of the drone
+	 * @return the reason to solve, or NONE
+	 */
+	Trigger check(double t, const ACADO::DVector &x);
+
+	MPCSolver &mpc;
+	TriggerParameters params;
+	TriggerStatistics statistics;
+	Trigger lastTrigger;
+	bool valid;                                 // The stored trajectory can be played back
+	double solveTime;                           // Time of the last solve
+	double interval;                            // Length of an interval of the prediction
+	ACADO::VariablesGrid predictedStates;
+	ACADO::VariablesGrid predictedControls;
+	std::array<double,3> solvedReference;      // Speed reference of the last solve
+	ACADO::DVector u;
+};
+
+#endif // EVENTTRIGGEREDMPC_H
@@ -0,0 +1,92 @@
+#ifndef EXPLICITCONTROLLER_H
+#define EXPLICITCONTROLLER_H
+
+#include <array>
+#include <string>
+#include <Eigen/Core>
+
+/**
+ * @brief The ExplicitController class is a fast approximation of the MPC, learned offline by train_explicit_mpc.
+ * It is a small neural network (two hidden layers, tanh) from the drone state and the speed reference to the velocity
+ * of the propellers. The position is not an input: the network stabilises the drone and follows the reference, but it
+ * does not know the obstacles, so the MPC must check it whenever there is time to run it.
+ */
+class ExplicitController
+{
+public:
+	static const int NB_INPUTS = 12;        // vx,vy,vz, phi,theta,psi, p,q,r and the 3 speed references
+	static const int NB_HIDDEN = 32;        // Size of each hidden layer
+	static const int NB_OUTPUTS = 4;        // Velocity of each propeller
+	static constexpr float DOMAIN_LIMIT = 2.f;  // Largest normalised input of the training domain (the samples are uniform,
+	                                            // so they lie within 1.73 standard deviations of the mean)
+
+	/**
+	 * @brief The Network struct holds the weights of the network and the normalisation of its inputs and outputs
+	 */
+	struct Network
+	{
+		Eigen::Matrix<float,NB_HIDDEN,NB_INPUTS> W1;
+		Eigen::Matrix<float,NB_HIDDEN,1> b1;
+		Eigen::Matrix<float,NB_HIDDEN,NB_HIDDEN> W2;
+		Eigen::Matrix<float,NB_HIDDEN,1> b2;
+		Eigen::Matrix<float,NB_OUTPUTS,NB_HIDDEN> W3;
+		Eigen::Matrix<float,NB_OUTPUTS,1> b3;
+		Eigen::Matrix<float,NB_INPUTS,1> inputMean, inputScale;
+		Eigen::Matrix<float,NB_OUTPUTS,1> outputMean, outputScale;
+	};
+
+	/**
+	 * @brief ExplicitController Creates a controller which always returns the hover velocity
+	 */
+	ExplicitController();
+
+	/**
+	 * @brief ExplicitController Creates a controller from trained weights
+	 * @param network Weights of the network
+	 */
+	ExplicitController(const Network &network);
+
+	/**
+	 * @brief load Read the weights written by save()
+	 * @param filename File to read
+	 * @return true if the file was read
+	 */
+	bool load(const std::string &filename);
+
+	/**
+	 * @brief save Write the weights to a text file
+	 * @param filename File to write
+	 * @return true if the file was written
+	 */
+	bool save(const std::string &filename) const;
+
+	/**
+	 * @brief evaluate Compute the command, in a few microseconds and without allocation
+	 * @param state State of the drone (x,y,z, vx,vy,vz, phi,theta,psi, p,q,r)
+	 * @param referenceVelocity Speed reference (vx,vy,vz)
+	 * @return the velocity of each propeller
+	 */
+	std::array<double,4> evaluate(const std::array<double,12> &state, const std::array<double,3> &referenceVelocity) const;
+
+	/**
+	 * @brief inDomain Tells if a state and a reference lie in the domain the network was trained on, outside of which
+	 * its command cannot be trusted
+	 * @param state State of the drone (x,y,z, vx,vy,vz, phi,theta,psi, p,q,r)
+	 * @param referenceVelocity Speed reference (vx,vy,vz)
+	 * @return true if every normalised input is within DOMAIN_LIMIT
+	 */
+	bool inDomain(const std::array<double,12> &state, const std::array<double,3> &referenceVelocity) const;
+
+private:
+	/**
+	 * @brief normalise Build the normalised input of the network
+	 */
+	Eigen::Matrix<float,NB_INPUTS,1> normalise(const std::array<double,12> &state, const std::array<double,3> &referenceVelocity) const;
+
+	Network network;
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+#endif // EXPLICITCONTROLLER_H
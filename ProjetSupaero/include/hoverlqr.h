@@ -0,0 +1,66 @@
+#ifndef HOVERLQR_H
+#define HOVERLQR_H
+
+#include <array>
+#include <vector>
+#include "dronemodel.h"
+
+/**
+ * @brief The HoverLQR class is a discrete LQR around the hover trim of the quadrotor, computed at startup.
+ *
+ * The linearisation at hover only depends on the yaw angle phi, which rotates the body rates into the derivatives of
+ * theta and psi. Gains are computed for a fixed number of yaw angles and the controller uses the closest one. The Riccati
+ * equation is solved with the doubling algorithm, which converges in a few tens of iterations even for a small period.
+ */
+class HoverLQR
+{
+public:
+	typedef Eigen::Matrix<double,4,12> Gain;
+
+	/**
+	 * @brief HoverLQR Computes the schedule of gains
+	 * @param period Sampling period of the controller
+	 * @param stateWeights Diagonal of the state weighting matrix
+	 * @param commandWeights Diagonal of the command weighting matrix
+	 * @param nbYawPoints Number of yaw angles of the schedule, on [-pi,pi)
+	 */
+	HoverLQR(double period, const std::array<double,12> &stateWeights = defaultStateWeights(),
+			 const std::array<double,4> &commandWeights = {{1e-2, 1e-2, 1e-2, 1e-2}}, unsigned int nbYawPoints = 36);
+
+	/**
+	 * @brief defaultStateWeights Weights on position and angles, lower weights on their derivatives
+	 * @return the weights
+	 */
+	static std::array<double,12> defaultStateWeights();
+
+	/**
+	 * @brief control Computes the command tracking a reference state
+	 * @param x State of the drone
+	 * @param xRef Reference state
+	 * @param uRef Command associated with the reference state
+	 * @return the velocity of the propellers
+	 */
+	DroneModel::Command control(const DroneModel::State &x, const DroneModel::State &xRef, const DroneModel::Command &uRef) const;
+
+	/**
+	 * @brief getGain Get the gain used for a yaw angle
+	 * @param phi Yaw angle
+	 * @return the gain
+	 */
+	const Gain &getGain(double phi) const;
+
+private:
+	/**
+	 * @brief solve Discretises the linearisation and solves the discrete Riccati equation
+	 * @param phi Yaw angle of the trim
+	 * @return the gain
+	 */
+	Gain solve(double phi) const;
+
+	double period;
+	DroneModel::StateMatrix Q;
+	Eigen::Matrix<double,4,4> R;
+	std::vector<Gain, Eigen::aligned_allocator<Gain> > gains;  // Gains for yaw angles evenly spread on [-pi,pi)
+};
+
+#endif // HOVERLQR_H
@@ -18,8 +18,22 @@ public:
 	 */
 	std::array<double,6> getReference();
 
+	/**
+	 * @brief pausePressed Reads the pause key (P)
+	 * @return true once each time the key is pressed
+	 */
+	bool pausePressed();
+
+	/**
+	 * @brief stepPressed Reads the key which advances a paused simulation by one step (S)
+	 * @return true once each time the key is pressed
+	 */
+	bool stepPressed();
+
 private: 
 	bool joystickOn_;
+	bool pauseKey_;
+	bool stepKey_;
 };
 
 #endif // INPUT_H
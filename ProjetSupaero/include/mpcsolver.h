@@ -2,32 +2,310 @@
 #define MPCSOLVER_H
 
 #include <array>
+#include <memory>
+#include <utility>
+#include <vector>
 #include <acado_toolkit.hpp>
 #include <acado_optimal_control.hpp>
-#include <acado_gnuplot.hpp>
+#include "environment.h"
 
 /**
- * @brief The MPCSolver class is an interface to the ACADO toolkit. Because of segfaults, it is not used yet.
- * It should provide a way to initialise all the ACADO variables, and a methode to call at every loop step.
+ * @brief The AttitudeModel enum selects the representation of the orientation of the drone in the model.
+ * EULER_ANGLES uses phi,theta,psi and needs theta to stay away from +-pi/2. QUATERNION uses qw,qx,qy,qz, has no
+ * singularity, and the state has one more variable.
+ */
+enum class AttitudeModel
+{
+	EULER_ANGLES, QUATERNION
+};
+
+/**
+ * @brief The ObstacleConstraints enum selects how the obstacles constrain the problem. CYLINDERS keeps the squared
+ * distance to each axis above the squared radius, a nonconvex constraint. CORRIDOR replaces each cylinder by a half-space
+ * which contains the predicted trajectory and excludes the cylinder: the constraints are linear, and together they
+ * bound a convex corridor around the path.
+ */
+enum class ObstacleConstraints
+{
+	CYLINDERS, CORRIDOR
+};
+
+/**
+ * @brief The MPCParameters struct gathers the tuning of the MPC. nbIntervals, nbObstacleSlots, obstacleConstraints, attitude,
+ * actuatorDynamics, vuMax, softConstraints and discretization define the structure of the optimal control problem and are fixed at construction.
+ * Every other field is an online parameter of the problem and can be changed at any time through the MPCSolver setters.
+ */
+struct MPCParameters
+{
+	/**
+	 * @brief MPCParameters Default tuning, the one previously hard-coded in main()
+	 */
+	MPCParameters();
+
+	/**
+	 * @brief longHorizon Multiple shooting on a 2 s horizon with 20 intervals. ACADO condenses the QP, so the states,
+	 * and the constant parameter states among them, do not add variables to it.
+	 * @return the parameters
+	 */
+	static MPCParameters longHorizon();
+
+	/**
+	 * @brief actuated Model with the propeller velocities as states, controlled by their accelerations. The problem keeps
+	 * single shooting: the four extra states only make the integration larger, as the QP has the controls as variables.
+	 * @return the parameters
+	 */
+	static MPCParameters actuated();
+
+	/**
+	 * @brief structureHash Hash of the fields which define the structure of the problem
+	 * @return the hash
+	 */
+	size_t structureHash() const;
+
+	/**
+	 * @brief sameStructure Compare the fields which define the structure of the problem
+	 * @param other Parameters to compare with
+	 * @return true if both parameters give the same problem, up to the online parameters
+	 */
+	bool sameStructure(const MPCParameters &other) const;
+
+	int nbIntervals;                        // Number of control intervals over the horizon
+	unsigned int nbObstacleSlots;           // Number of obstacles taken into account at each step
+	ObstacleConstraints obstacleConstraints;    // Form of the constraints of each obstacle
+	AttitudeModel attitude;                 // Representation of the orientation in the model
+	bool actuatorDynamics;                  // The controls are the accelerations of the propellers instead of their velocities
+	double vuMax;                           // Bound on the acceleration of each propeller, with actuatorDynamics
+	bool softConstraints;                   // The obstacle and attitude constraints can be violated, at a cost
+	double slackPenalty;                    // Cost of a unit violation of a soft constraint (L1 exact penalty)
+	int discretization;                     // SINGLE_SHOOTING or MULTIPLE_SHOOTING
+	double horizon;                         // Length of the horizon in seconds
+	std::array<double,10> weights;          // Diagonal of the LSQ coefficient matrix
+	double uMin, uMax;                      // Bounds on the velocity of each propeller
+	double safetyMargin;                    // Distance kept between the drone and the surface of the obstacles
+};
+
+/**
+ * @brief The MPCSolver class is an interface to the ACADO toolkit. It builds the drone model and the optimal control
+ * problem once, and provides a method to call at every loop step.
+ *
+ * The online parameters (horizon, weights, propeller bounds and obstacles) are appended to the drone state as constant
+ * states: the initial value embedding of the real-time iteration fixes them to the values given at each step, so that
+ * they can be changed without rebuilding the RealTimeAlgorithm. Obstacles are given to the solver through a fixed
+ * number of slots, filled at each step with the obstacles closest to the drone. The position of the obstacles in a slot
+ * follows their velocity along the horizon. With the CORRIDOR constraints, the half-space of each slot is tangent to
+ * the cylinder, facing the point of the last predicted trajectory closest to its axis.
+ *
+ * With soft constraints, the obstacle constraints and the attitude constraint are relaxed by slack controls, so that the
+ * problem stays feasible when a disturbance pushes the drone inside a safety margin. The slacks are penalised with an L1
+ * exact penalty, written as a least-squares term with a negative reference so that the Gauss-Newton Hessian is kept: the
+ * constraints are only violated when they cannot be satisfied.
+ *
+ * Building the symbolic problem takes most of the startup time. Since it only depends on the structure of the problem,
+ * the first solver of each structure keeps a copy of it, and the next solvers with the same structure copy it instead of
+ * building it again.
  */
 class MPCSolver
 {
 public:
+	static const unsigned int NB_STATES = 12;       // Number of states of the drone with Euler angles
+	static const unsigned int NB_STATES_QUATERNION = 13;    // Number of states of the drone with a quaternion
+	static const unsigned int NB_ACTUATOR_STATES = 4;       // Number of propeller velocities added with actuatorDynamics
+	static const unsigned int NB_CONTROLS = 4;      // Number of controls of the drone
+	static const unsigned int NB_OUTPUTS = 10;      // Number of outputs in the LSQ function
+
+	/**
+	 * @brief MPCSolver Builds the drone model, the optimal control problem and the real-time algorithm
+	 * @param parameters Structure and initial values of the online parameters
+	 */
+	MPCSolver(const MPCParameters &parameters = MPCParameters());
+
+	/**
+	 * @brief clearPrototypes Forget the problems kept for the next solvers, the existing solvers are not affected
+	 */
+	static void clearPrototypes();
+
+	/**
+	 * @brief getModel Get the drone dynamics, without the online parameters (useful to simulate the drone)
+	 * @return the differential equation of the drone
+	 */
+	const ACADO::DifferentialEquation &getModel() const;
+
 	/**
-	 * @brief MPCSolver Initialises all the variables
+	 * @brief getNbStates Get the number of states of the model, which depends on the attitude model and the actuators
+	 * @return NB_STATES or NB_STATES_QUATERNION, plus NB_ACTUATOR_STATES with actuatorDynamics
 	 */
-	MPCSolver();
+	unsigned int getNbStates() const;
 
 	/**
-	 * @brief controlMPC Calls the MPC algorithm to solve one temporal step of the constrained optimal problem of driving the drone
-	 * without hitting obstacles
-	 * @param t Discretised time variable
-	 * @param dt Discretisation step
+	 * @brief getNbDroneStates Get the number of states of the rigid body, the propeller velocities start after them
+	 * @return NB_STATES or NB_STATES_QUATERNION
 	 */
-//	void controlMPC(double t, double dt);
+	unsigned int getNbDroneStates() const;
+
+	/**
+	 * @brief getParameters Get the current values of the parameters
+	 * @return the parameters
+	 */
+	const MPCParameters &getParameters() const;
+
+	/**
+	 * @brief init Initialises the controller
+	 * @param t Initial time
+	 * @param x Initial state of the drone
+	 */
+	void init(double t, const ACADO::DVector &x);
+
+	/**
+	 * @brief setHorizon Change the length of the horizon, the number of intervals stays the same
+	 * @param horizon Length of the horizon in seconds
+	 */
+	void setHorizon(double horizon);
+
+	/**
+	 * @brief setWeights Change the diagonal of the LSQ coefficient matrix
+	 * @param weights New weights, in the order of the LSQ function (vx,vy,vz, u1,u2,u3,u4, p,q,r)
+	 */
+	void setWeights(const std::array<double,10> &weights);
+
+	/**
+	 * @brief setPropellerBounds Change the bounds on the velocity of each propeller
+	 * @param uMin Lower bound
+	 * @param uMax Upper bound
+	 */
+	void setPropellerBounds(double uMin, double uMax);
+
+	/**
+	 * @brief setSafetyMargin Change the distance kept between the drone and the obstacles
+	 * @param margin Distance to the surface of the cylinders
+	 */
+	void setSafetyMargin(double margin);
+
+	/**
+	 * @brief setSlackPenalty Change the cost of a unit violation of the soft constraints, given by the reference of the slacks
+	 * @param penalty Slope of the penalty of the slacks at 0
+	 */
+	void setSlackPenalty(double penalty);
+
+	/**
+	 * @brief setObstacles Change the set of obstacles. At each step, the closest ones are assigned to the slots, and
+	 * their motion is predicted over the horizon from their current velocity.
+	 * @param environment Environment whose obstacles are avoided, they are shared with the solver
+	 */
+	void setObstacles(const Environment &environment);
+
+	/**
+	 * @brief addObstacles Add obstacles to the set of obstacles
+	 * @param obstacles List of obstacles to add
+	 */
+	void addObstacles(const std::vector<ObstaclePtr> &obstacles);
+
+	/**
+	 * @brief removeObstacles Remove obstacles from the set of obstacles
+	 * @param ids Ids of the cylinders to remove
+	 */
+	void removeObstacles(const std::vector<unsigned int> &ids);
+
+	/**
+	 * @brief setReference Set the reference of the LSQ function for the next steps
+	 * @param reference Reference trajectory, in the order of the LSQ function
+	 */
+	void setReference(const ACADO::VariablesGrid &reference);
+
+	/**
+	 * @brief step Solves one temporal step of the constrained optimal problem of driving the drone without hitting obstacles
+	 * @param t Current time
+	 * @param x Current state of the drone
+	 * @return true if the solver succeeded
+	 */
+	bool step(double t, const ACADO::DVector &x);
+
+	/**
+	 * @brief getU Get the command computed by the last step
+	 * @param u Velocity of each propeller, or its acceleration with actuatorDynamics
+	 */
+	void getU(ACADO::DVector &u);
+
+	/**
+	 * @brief getObstacleSlack Get the violation of the obstacle constraints on the first interval of the last step
+	 * @return the slack, 0 when the constraints are satisfied or hard
+	 */
+	double getObstacleSlack() const;
+
+	/**
+	 * @brief getAttitudeSlack Get the violation of the attitude constraint on the first interval of the last step
+	 * @return the slack, 0 when the constraint is satisfied, hard or absent
+	 */
+	double getAttitudeSlack() const;
+
+	/**
+	 * @brief getPrediction Get the trajectory optimised by the last step. Node k of the grids is k intervals
+	 * (horizon/nbIntervals) after the time of the step.
+	 * @param states Predicted states at each node, followed by the online parameters
+	 * @param controls Predicted controls on each interval, followed by the slacks
+	 */
+	void getPrediction(ACADO::VariablesGrid &states, ACADO::VariablesGrid &controls) const;
+
+	/**
+	 * @brief getReference Get the reference given by the user
+	 * @return the reference, in the order of the LSQ function
+	 */
+	const ACADO::VariablesGrid &getReference() const;
+
+	/**
+	 * @brief getObstacleDistance Get the distance between the drone and the closest obstacle
+	 * @param t Current time
+	 * @param x Current state of the drone
+	 * @return the distance to the surface of the closest cylinder, without the safety margin
+	 */
+	float getObstacleDistance(double t, const ACADO::DVector &x) const;
 
 private:
+	/**
+	 * @brief buildProblem Build the drone model, the optimal control problem and the real-time algorithm
+	 */
+	void buildProblem();
+
+	/**
+	 * @brief fillObstacleSlots Write the obstacles closest to the drone in the parameter part of the augmented state,
+	 * with their position and velocity at the current time
+	 * @param t Current time
+	 * @param x Current state of the drone
+	 */
+	void fillObstacleSlots(double t, const ACADO::DVector &x);
+
+	/**
+	 * @brief augmentState Build the state seen by the solver: the drone state followed by the online parameters
+	 * @param t Current time
+	 * @param x Current state of the drone
+	 */
+	void augmentState(double t, const ACADO::DVector &x);
+
+	/**
+	 * @brief fillCorridorSlot Write the half-space separating an obstacle from the predicted trajectory in a slot
+	 * @param s Index of the slot in the augmented state
+	 * @param obstacle Obstacle
+	 * @param t Current time
+	 * @param x Current state of the drone
+	 */
+	void fillCorridorSlot(unsigned int s, const Eobstacle &obstacle, double t, const ACADO::DVector &x);
 
+	MPCParameters params;                               // Current values of the parameters
+	unsigned int nbDroneStates;                         // Number of states of the rigid body
+	unsigned int nbStates;                              // Number of states of the model, the parameters start after them
+	unsigned int slotSize;                              // Number of parameters of an obstacle slot
+	unsigned int nbSlacks;                              // Number of slack controls, after the drone controls
+	unsigned int nbOutputs;                             // Size of the LSQ function, with the penalty of the slacks
+	std::vector<ObstaclePtr> obstacles;                 // Obstacles to assign to the slots
+	std::vector<std::pair<float,unsigned int> > slotCandidates; // Preallocated buffer used to sort the obstacles
+	ACADO::DifferentialEquation model;                  // Drone dynamics
+	std::unique_ptr<ACADO::RealTimeAlgorithm> alg;      // Real-time iteration on the optimal control problem
+	std::unique_ptr<ACADO::Controller> controller;      // Controller wrapping the algorithm
+	ACADO::DVector xAugmented;                          // Drone state followed by the online parameters
+	ACADO::VariablesGrid reference;                     // Reference given by the user
+	ACADO::VariablesGrid scaledReference;               // Reference multiplied by the square root of the weights
+	ACADO::VariablesGrid prediction;                    // States predicted by the last step, used by the corridor
+	ACADO::DVector controls;                            // Controls of the last step, with the slacks
+	bool hasPrediction;
 };
 
 #endif // MPCSOLVER_H
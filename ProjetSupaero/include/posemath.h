@@ -0,0 +1,50 @@
+#ifndef POSEMATH_H
+#define POSEMATH_H
+
+#include <cmath>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+/**
+ * @brief The PoseMath namespace gathers the orientation computations of the viewer, on fixed-size float types. The
+ * quaternions are built directly from half angles instead of multiplying rotation matrices.
+ */
+namespace PoseMath
+{
+	/**
+	 * @brief axisOrientation Orientation of an object whose local z axis points along a direction, the rotation being
+	 * Rz(atan2(dy,dx))*Ry(atan2(sqrt(dx^2+dy^2),dz))
+	 * @param dx
+	 * @param dy
+	 * @param dz
+	 * @return the quaternion of the orientation
+	 */
+	inline Eigen::Quaternionf axisOrientation(float dx, float dy, float dz)
+	{
+		float a = std::atan2(dy, dx) / 2.f;
+		float b = std::atan2(std::sqrt(dx*dx+dy*dy), dz) / 2.f;
+		float ca = std::cos(a), sa = std::sin(a), cb = std::cos(b), sb = std::sin(b);
+		return Eigen::Quaternionf(ca*cb, -sa*sb, ca*sb, sa*cb);
+	}
+
+	/**
+	 * @brief rpyOrientation Orientation given by roll-pitch-yaw angles, the rotation being Rx(roll)*Ry(pitch)*Rz(yaw) as in
+	 * the model of the drone (DroneModel::attitude(yaw, pitch, roll), with phi = yaw, theta = pitch and psi = roll)
+	 * @param roll
+	 * @param pitch
+	 * @param yaw
+	 * @return the quaternion of the orientation
+	 */
+	inline Eigen::Quaternionf rpyOrientation(float roll, float pitch, float yaw)
+	{
+		float cr = std::cos(roll/2.f), sr = std::sin(roll/2.f);
+		float cp = std::cos(pitch/2.f), sp = std::sin(pitch/2.f);
+		float cy = std::cos(yaw/2.f), sy = std::sin(yaw/2.f);
+		return Eigen::Quaternionf(cr*cp*cy - sr*sp*sy,
+								  sr*cp*cy + cr*sp*sy,
+								  cr*sp*cy - sr*cp*sy,
+								  cr*cp*sy + sr*sp*cy);
+	}
+}
+
+#endif // POSEMATH_H
@@ -0,0 +1,37 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <cstddef>
+
+/**
+ * @brief The RealTimeProfile struct describes how the control thread runs on a flight computer: pinned to a core kept
+ * free of other work (isolcpus), under the SCHED_FIFO policy so that only threads of higher priority preempt it, with
+ * the memory of the process locked so that no page fault delays it.
+ */
+struct RealTimeProfile
+{
+	RealTimeProfile();
+
+	int cpu;                                // Core of the thread, -1 to keep its affinity
+	int priority;                           // SCHED_FIFO priority, from 1 to 99, 0 to keep the default policy
+	bool lockMemory;                        // Lock the current and future pages of the process in memory
+	size_t stackPrefault;                   // Bytes of stack touched in advance, so that its pages are resident
+};
+
+/**
+ * @brief The RealTime namespace applies a RealTimeProfile. The threads started before keep their policy and are moved
+ * to the other cores, so the profile is applied once the helper threads (estimator, watchers, viewer client) run.
+ */
+namespace RealTime
+{
+	/**
+	 * @brief apply Apply a profile to the calling thread. Each step needs the matching privilege (CAP_SYS_NICE,
+	 * CAP_IPC_LOCK or the limits of /etc/security/limits.conf); a step which fails is reported and the others are
+	 * still applied.
+	 * @param profile Profile to apply
+	 * @return true if every step succeeded
+	 */
+	bool apply(const RealTimeProfile &profile);
+}
+
+#endif // REALTIME_H
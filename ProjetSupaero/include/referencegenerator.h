@@ -0,0 +1,93 @@
+#ifndef REFERENCEGENERATOR_H
+#define REFERENCEGENERATOR_H
+
+#include <array>
+#include <vector>
+
+/**
+ * @brief The ReferenceGenerator class turns speed commands or waypoints into a reference trajectory for the 10 outputs
+ * of the LSQ function (vx,vy,vz, u1,u2,u3,u4, p,q,r), sampled on the nodes of the horizon.
+ *
+ * The speed reference is smoothed with acceleration and jerk limits. At each update, the smoothed state is advanced by
+ * the elapsed time, then the preview over the horizon is computed from it, in a buffer allocated at construction.
+ */
+class ReferenceGenerator
+{
+public:
+	typedef std::array<double,10> Point;
+	typedef std::array<double,3> Vector;
+
+	/**
+	 * @brief ReferenceGenerator Allocates the preview buffer
+	 * @param nbIntervals Number of intervals of the horizon
+	 * @param horizon Length of the horizon in seconds
+	 * @param maxAcceleration Limit on the acceleration of the reference
+	 * @param maxJerk Limit on the jerk of the reference
+	 */
+	ReferenceGenerator(int nbIntervals, double horizon, double maxAcceleration = 4., double maxJerk = 20.);
+
+	/**
+	 * @brief setHorizon Change the length of the horizon, the number of intervals stays the same
+	 * @param horizon Length of the horizon in seconds
+	 */
+	void setHorizon(double horizon);
+
+	/**
+	 * @brief update Advance the reference by dt towards a speed command, which is kept over the whole horizon
+	 * @param dt Time elapsed since the last update
+	 * @param command Speed command (3 translation speeds)
+	 */
+	void update(double dt, const Vector &command);
+
+	/**
+	 * @brief update Advance the reference by dt towards a list of waypoints to follow at a given speed. Over the horizon,
+	 * the predicted position moves to the next waypoint once it is closer than the acceptance radius.
+	 * @param dt Time elapsed since the last update
+	 * @param position Current position of the drone
+	 * @param waypoints Positions to reach, in order. Reached waypoints are not removed from the list.
+	 * @param speed Cruise speed
+	 * @param acceptance Distance under which a waypoint is reached
+	 */
+	void update(double dt, const Vector &position, const std::vector<Vector> &waypoints, double speed, double acceptance = 1.);
+
+	/**
+	 * @brief getNbPoints Get the number of points of the preview (number of intervals + 1)
+	 * @return the number of points
+	 */
+	unsigned int getNbPoints() const;
+
+	/**
+	 * @brief getPoint Get a point of the preview
+	 * @param i Index of the node, 0 being the current time
+	 * @return the reference of the outputs at node i
+	 */
+	const Point &getPoint(unsigned int i) const;
+
+private:
+	/**
+	 * @brief advance Apply one step of the jerk-limited filter on each axis
+	 * @param velocity Velocity of the filter
+	 * @param acceleration Acceleration of the filter
+	 * @param target Target velocity
+	 * @param dt Time step
+	 */
+	void advance(Vector &velocity, Vector &acceleration, const Vector &target, double dt) const;
+
+	/**
+	 * @brief writePoint Write a velocity in the preview, with the other outputs at hover
+	 * @param i Index of the node
+	 * @param velocity Velocity of the reference
+	 */
+	void writePoint(unsigned int i, const Vector &velocity);
+
+	int nbIntervals;
+	double horizon;
+	double maxAcceleration;
+	double maxJerk;
+	Vector velocity;                        // Current state of the filter
+	Vector acceleration;
+	unsigned int currentWaypoint;           // Next waypoint to reach by the drone
+	std::vector<Point> preview;             // Reference on the nodes of the horizon
+};
+
+#endif // REFERENCEGENERATOR_H
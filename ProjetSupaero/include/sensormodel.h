@@ -0,0 +1,81 @@
+#ifndef SENSORMODEL_H
+#define SENSORMODEL_H
+
+#include <random>
+#include <vector>
+#include "dronemodel.h"
+
+/**
+ * @brief The SensorParameters struct gathers the rates and the noise of the simulated sensors. The noises are standard
+ * deviations of white gaussian noises.
+ */
+struct SensorParameters
+{
+	/**
+	 * @brief SensorParameters Rates and noises of a small IMU and a motion capture system
+	 */
+	SensorParameters();
+
+	double imuRate;                         // Rate of the IMU, in Hz
+	double poseRate;                        // Rate of the pose sensor, in Hz
+	double accelerometerNoise;              // In m/s^2
+	double gyroscopeNoise;                  // In rad/s
+	double positionNoise;                   // In m
+	double orientationNoise;                // In rad, on each axis
+	unsigned int seed;                      // Seed of the noises
+};
+
+/**
+ * @brief The SensorSample struct is a measurement of the IMU or of the pose sensor
+ */
+struct SensorSample
+{
+	enum Type
+	{
+		IMU, POSE
+	};
+
+	Type type;
+	double t;
+	Eigen::Vector3d acceleration;           // IMU: specific force in the body frame
+	Eigen::Vector3d angularVelocity;        // IMU: p, q, r
+	Eigen::Vector3d position;               // POSE: position in the world frame
+	Eigen::Vector4d orientation;            // POSE: quaternion of the rotation from the body frame to the world frame (w,x,y,z)
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+typedef std::vector<SensorSample, Eigen::aligned_allocator<SensorSample> > SensorSamples;
+
+/**
+ * @brief The SensorModel class simulates an IMU and a pose sensor on the drone. The simulation gives the state at the
+ * end of each step, and the sensors sample it at their own rate, interpolating the state within the step.
+ */
+class SensorModel
+{
+public:
+	SensorModel(const SensorParameters &parameters = SensorParameters());
+
+	/**
+	 * @brief update Generate the measurements of the sensors between two states of the simulation
+	 * @param t0 Time of the first state
+	 * @param x0 First state, in which the previous measurements were taken
+	 * @param t1 Time of the second state
+	 * @param x1 Second state
+	 * @param u Command applied between the two states
+	 * @param samples Measurements taken in (t0,t1], in order of time. The vector is cleared first, and keeps its capacity.
+	 */
+	void update(double t0, const DroneModel::State &x0, double t1, const DroneModel::State &x1, const DroneModel::Command &u,
+				SensorSamples &samples);
+
+	const SensorParameters &getParameters() const;
+
+private:
+	SensorParameters params;
+	std::mt19937 rng;
+	std::normal_distribution<double> noise; // Standard normal distribution
+	unsigned long nbImuSamples;             // Number of samples taken, which gives the time of the next one
+	unsigned long nbPoseSamples;
+};
+
+#endif // SENSORMODEL_H
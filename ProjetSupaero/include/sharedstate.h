@@ -0,0 +1,134 @@
+#ifndef SHAREDSTATE_H
+#define SHAREDSTATE_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief The SharedStateRecord struct is what the control loop publishes at each step. It is copied as it is into
+ * shared memory, so it only holds plain data.
+ */
+struct SharedStateRecord
+{
+	enum SolverStatus : int32_t
+	{
+		SOLVER_SUCCEEDED, SOLVER_FAILED, SOLVER_SKIPPED, SOLVER_PLAYED_BACK
+	};
+
+	uint64_t index;                         // Number of the record since the publisher started
+	double t;                               // Simulation time
+	uint32_t nbStates;                      // Number of states used in state, 12 with Euler angles and 13 with a quaternion,
+	                                        // followed by the 4 propeller velocities with the actuator model
+	int32_t solverStatus;                   // Status of the last MPC step
+	double state[17];
+	double controls[4];                     // Velocity of the propellers, or their acceleration with the actuator model
+	double reference[3];                    // Speed reference
+	double solveTime;                       // Duration of the last MPC step, in seconds
+	uint64_t nbSolves;                      // Number of MPC solves since the start
+	int32_t trigger;                        // Reason of the last solve of the event-triggered MPC (see Trigger)
+	double obstacleSlack;                   // Violation of the obstacle constraints by the last MPC step
+	double attitudeSlack;                   // Violation of the attitude constraint by the last MPC step
+};
+
+/**
+ * @brief The SharedStatePublisher class publishes the records of the control loop in a POSIX shared memory ring buffer.
+ * Each slot is protected by a sequence lock: the publisher never waits for the readers, and a reader retries when the
+ * slot it reads is written at the same time. Any number of processes can read with SharedStateReader.
+ */
+class SharedStatePublisher
+{
+public:
+	/**
+	 * @brief SharedStatePublisher Creates the shared memory object, replacing any previous one of the same name
+	 * @param name Name of the object, starting with a slash (e.g. /ProjectSupaero)
+	 * @param nbSlots Number of records kept in the ring buffer, at least one
+	 */
+	SharedStatePublisher(const std::string &name, unsigned int nbSlots = 1024);
+
+	/**
+	 * @brief ~SharedStatePublisher Unmaps and removes the shared memory object, the readers keep their mapping
+	 */
+	~SharedStatePublisher();
+
+	SharedStatePublisher(const SharedStatePublisher&) = delete;
+	SharedStatePublisher &operator=(const SharedStatePublisher&) = delete;
+
+	/**
+	 * @brief isOpen Tells if the shared memory could be created
+	 * @return true if publish writes to shared memory
+	 */
+	bool isOpen() const;
+
+	/**
+	 * @brief publish Write a record in the next slot. Its index is set by the publisher.
+	 * @param record Record to publish
+	 */
+	void publish(SharedStateRecord &record);
+
+private:
+	std::string name;
+	size_t size;                            // Size of the mapping
+	void *memory;                           // Mapping of the shared memory, nullptr if it could not be created
+	uint64_t nbPublished;
+};
+
+/**
+ * @brief The SharedStateReader class reads the records published by a SharedStatePublisher
+ */
+class SharedStateReader
+{
+public:
+	/**
+	 * @brief SharedStateReader Maps the shared memory object read-only
+	 * @param name Name of the object given to the publisher
+	 */
+	SharedStateReader(const std::string &name);
+
+	~SharedStateReader();
+
+	SharedStateReader(const SharedStateReader&) = delete;
+	SharedStateReader &operator=(const SharedStateReader&) = delete;
+
+	/**
+	 * @brief isOpen Tells if the shared memory object exists and has the expected layout
+	 * @return true if records can be read
+	 */
+	bool isOpen() const;
+
+	/**
+	 * @brief latest Read the last record published
+	 * @param record Record read
+	 * @return false if nothing was published yet, or if the publisher stopped while writing it
+	 */
+	bool latest(SharedStateRecord &record);
+
+	/**
+	 * @brief next Read the records in order, from the first one published after the reader was created. When the
+	 * reader is too slow and the publisher overwrote records, the oldest record still available is read.
+	 * @param record Record read
+	 * @return false if there is no new record, or if the publisher stopped while writing it
+	 */
+	bool next(SharedStateRecord &record);
+
+	/**
+	 * @brief getNbLost Get the number of records overwritten before next could read them
+	 * @return the number of records lost
+	 */
+	uint64_t getNbLost() const;
+
+private:
+	/**
+	 * @brief read Read a record with the sequence lock of its slot
+	 * @param index Index of the record
+	 * @param record Record read
+	 * @return false if the record was overwritten by a newer one, or if its slot stayed locked after some retries
+	 */
+	bool read(uint64_t index, SharedStateRecord &record);
+
+	size_t size;
+	const void *memory;
+	uint64_t nextIndex;                     // Index of the next record read by next
+	uint64_t nbLost;
+};
+
+#endif // SHAREDSTATE_H
@@ -0,0 +1,78 @@
+#ifndef SIMULATIONCLOCK_H
+#define SIMULATIONCLOCK_H
+
+#include <chrono>
+
+/**
+ * @brief The ClockMode enum selects how the simulated time follows the wall clock. REAL_TIME follows it, SCALED
+ * follows it multiplied by a factor, and LOCKSTEP advances by a fixed step at each tick, as fast as the controller and
+ * the simulation run, so that the results do not depend on the speed of the machine.
+ */
+enum class ClockMode
+{
+	REAL_TIME, LOCKSTEP, SCALED
+};
+
+/**
+ * @brief The SimulationClock class gives the time step of each iteration of the simulation loop. It measures the wall
+ * clock (not the CPU time of the process), and can be paused and stepped one fixed step at a time.
+ */
+class SimulationClock
+{
+public:
+	/**
+	 * @brief SimulationClock
+	 * @param mode How the simulated time follows the wall clock
+	 * @param step Step of the LOCKSTEP mode, and of stepOnce, in seconds
+	 * @param scale Ratio of the simulated time to the wall clock in SCALED mode
+	 */
+	SimulationClock(ClockMode mode = ClockMode::REAL_TIME, double step = 0.02, double scale = 1.);
+
+	/**
+	 * @brief tick Advance the simulated time, called once per iteration of the loop
+	 * @return the simulated time elapsed since the last tick
+	 */
+	double tick();
+
+	/**
+	 * @brief getTime Get the simulated time
+	 * @return the time in seconds
+	 */
+	double getTime() const;
+
+	/**
+	 * @brief setPaused Stop or restart the simulated time, the wall clock elapsed while paused is not simulated
+	 * @param paused true to pause
+	 */
+	void setPaused(bool paused);
+
+	/**
+	 * @brief stepOnce While paused, let the next tick advance the simulated time by one step
+	 */
+	void stepOnce();
+
+	/**
+	 * @brief isRunning Check whether the next tick advances the simulated time
+	 * @return false while paused, unless a step was requested
+	 */
+	bool isRunning() const;
+
+	bool isPaused() const;
+	ClockMode getMode() const;
+	double getStep() const;
+	double getScale() const;
+
+private:
+	typedef std::chrono::steady_clock Wall;
+
+	ClockMode mode;
+	double step;
+	double scale;
+	double t;                               // Simulated time
+	unsigned long nbSteps;                  // Number of steps of the LOCKSTEP mode, the time is computed from it
+	Wall::time_point lastTick;
+	bool paused;
+	bool stepRequested;
+};
+
+#endif // SIMULATIONCLOCK_H
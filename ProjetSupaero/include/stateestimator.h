@@ -0,0 +1,147 @@
+#ifndef STATEESTIMATOR_H
+#define STATEESTIMATOR_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "dronemodel.h"
+#include "sensormodel.h"
+
+/**
+ * @brief The Ekf class is an error-state extended Kalman filter on the position, the velocity and the orientation of
+ * the drone. The IMU samples drive the prediction and the pose samples correct it. The orientation is kept as a
+ * quaternion and its error as a small rotation in the body frame. Every matrix has a fixed size, so that an update does
+ * not allocate memory.
+ */
+class Ekf
+{
+public:
+	typedef Eigen::Matrix<double,9,9> Covariance;
+
+	Ekf(const SensorParameters &parameters = SensorParameters());
+
+	/**
+	 * @brief init Reset the filter to a known state
+	 * @param t Time of the state
+	 * @param x State of the drone
+	 */
+	void init(double t, const DroneModel::State &x);
+
+	/**
+	 * @brief predict Propagate the estimate to the time of an IMU sample
+	 * @param sample IMU sample
+	 */
+	void predict(const SensorSample &sample);
+
+	/**
+	 * @brief correct Correct the estimate with a pose sample, considered taken at the time of the estimate
+	 * @param sample Pose sample
+	 */
+	void correct(const SensorSample &sample);
+
+	/**
+	 * @brief getState Get the estimate, the angular velocity being the last one measured
+	 * @return the state with Euler angles
+	 */
+	DroneModel::State getState() const;
+
+	double getTime() const;
+	const Covariance &getCovariance() const;
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+	SensorParameters params;
+	double t;
+	Eigen::Vector3d position;
+	Eigen::Vector3d velocity;
+	Eigen::Quaterniond orientation;
+	Eigen::Vector3d angularVelocity;
+	Covariance P;
+};
+
+/**
+ * @brief The StateEstimator class runs an Ekf on its own thread. The simulation pushes the sensor samples, which the
+ * thread processes in order as soon as they arrive, and the control loop reads the last estimate without waiting for
+ * the filter. The samples go through a fixed-size queue, in which the oldest ones are dropped if the thread falls behind.
+ */
+class StateEstimator
+{
+public:
+	/**
+	 * @brief StateEstimator Starts the thread of the filter
+	 * @param parameters Noises of the sensors, used by the filter
+	 */
+	StateEstimator(const SensorParameters &parameters = SensorParameters());
+
+	/**
+	 * @brief ~StateEstimator Stops the thread
+	 */
+	~StateEstimator();
+
+	/**
+	 * @brief init Reset the filter to a known state
+	 * @param t Time of the state
+	 * @param x State of the drone
+	 */
+	void init(double t, const DroneModel::State &x);
+
+	/**
+	 * @brief push Give new samples to the filter, without waiting for them to be processed
+	 * @param samples Samples in order of time
+	 */
+	void push(const SensorSamples &samples);
+
+	/**
+	 * @brief waitIdle Wait until the filter has processed every sample pushed so far, so that the next estimate does
+	 * not depend on the speed of the thread (lockstep simulation)
+	 */
+	void waitIdle();
+
+	/**
+	 * @brief getEstimate Get the last estimate
+	 * @param x State with Euler angles
+	 * @return the time of the estimate
+	 */
+	double getEstimate(DroneModel::State &x);
+
+	/**
+	 * @brief getMeanUpdateTime Get the mean duration of an update of the filter
+	 * @return the duration in seconds
+	 */
+	double getMeanUpdateTime() const;
+
+	unsigned long getNbUpdates() const;
+	unsigned long getNbDropped() const;
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+	/**
+	 * @brief run Loop of the thread, processes the samples of the queue
+	 */
+	void run();
+
+	static const unsigned int QUEUE_SIZE = 1024;
+
+	Ekf ekf;                                        // Only used by the thread once started
+	std::array<SensorSample, QUEUE_SIZE> queue;     // Ring buffer of the samples to process
+	unsigned long queueBegin, queueEnd;             // Number of samples taken from and put in the queue
+	DroneModel::State estimate;                     // Last estimate, and its time
+	double estimateTime;
+	bool reset;                                     // init was called, the thread must reset the filter
+	bool processing;                                // The thread is processing a sample taken from the queue
+	double resetTime;
+	DroneModel::State resetState;
+	std::mutex mutex;                               // Protects the queue, the estimate and the reset
+	std::condition_variable condition;
+	std::condition_variable idle;                   // Notified when the queue has been processed
+	std::atomic<bool> running;
+	std::atomic<unsigned long> nbUpdates, nbDropped;
+	std::atomic<double> updateTime;                 // Total duration of the updates
+	std::thread thread;
+};
+
+#endif // STATEESTIMATOR_H
@@ -0,0 +1,59 @@
+#ifndef STLMESH_H
+#define STLMESH_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The StlMesh class reads, simplifies and writes triangle meshes in the STL format. It is used to prepare the
+ * drone model before giving it to gepetto: the mesh is decimated once, and the result is cached in a file which is
+ * reused while the source does not change.
+ */
+class StlMesh
+{
+public:
+	typedef std::array<float,9> Triangle;   // Coordinates of the three vertices
+
+	/**
+	 * @brief load Read a binary or ASCII STL file
+	 * @param filename Name of the file
+	 * @return true if the file was read
+	 */
+	bool load(const std::string &filename);
+
+	/**
+	 * @brief save Write the mesh to a binary STL file, with normals computed from the vertices
+	 * @param filename Name of the file
+	 * @return true if the file was written
+	 */
+	bool save(const std::string &filename) const;
+
+	/**
+	 * @brief decimate Simplify the mesh by vertex clustering: the vertices in the same cubic cell are merged to their
+	 * mean, and the triangles which become degenerate or duplicated are removed
+	 * @param cellSize Size of the cells, in the units of the mesh
+	 */
+	void decimate(float cellSize);
+
+	/**
+	 * @brief getNbTriangles Get the number of triangles
+	 * @return the number of triangles
+	 */
+	unsigned int getNbTriangles() const;
+
+	/**
+	 * @brief cached Get a decimated version of a mesh, from the cache if it is more recent than the source, or by
+	 * decimating and caching it otherwise. The cache is in the temporary directory, named after the source, its absolute
+	 * path and the cell size. It is replaced atomically, so concurrent processes can share it.
+	 * @param filename Name of the source STL file
+	 * @param cellSize Size of the cells of the decimation
+	 * @return the name of the decimated file, or filename itself if it could not be decimated
+	 */
+	static std::string cached(const std::string &filename, float cellSize);
+
+private:
+	std::vector<Triangle> triangles;
+};
+
+#endif // STLMESH_H
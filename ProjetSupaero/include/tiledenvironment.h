@@ -0,0 +1,138 @@
+#ifndef TILEDENVIRONMENT_H
+#define TILEDENVIRONMENT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "environment.h"
+#include "environmentwatcher.h"
+
+/**
+ * @brief The TileStatistics struct describes the activity of the tile cache of a TiledEnvironment
+ */
+struct TileStatistics
+{
+	unsigned long hits;                     // Tiles needed by the drone and found in the cache
+	unsigned long misses;                   // Tiles needed by the drone and loaded on the spot
+	unsigned long prefetched;               // Tiles loaded by the prefetch thread
+	unsigned long evicted;                  // Tiles removed from the cache
+	unsigned int nbCached;                  // Tiles in the cache
+	double meanLoadTime;                    // Duration of the loads, in seconds
+	double maxLoadTime;
+};
+
+/**
+ * @brief The TiledEnvironment class streams a large environment split into square tiles of the xy plane, each stored in
+ * its own XML file (see build). Only the tiles around the drone are given to the solver and the viewer, as changes of
+ * the environment like the ones of EnvironmentWatcher. The tiles live in an LRU cache of bounded size, which a
+ * background thread fills ahead of the drone, in the direction of its velocity.
+ *
+ * A cylinder belongs to every tile its bounding box overlaps at time 0, so a moving cylinder is only seen from the
+ * tiles it started in.
+ */
+class TiledEnvironment
+{
+public:
+	/**
+	 * @brief TiledEnvironment Opens a tiled environment and starts the prefetch thread
+	 * @param directory Directory written by build
+	 * @param maxCachedTiles Largest number of tiles kept in memory
+	 * @param activeRadius The active tiles are the ones at most this number of tiles away from the tile of the drone
+	 * @param lookAhead The thread prefetches the tiles around the position of the drone this time ahead, in seconds
+	 */
+	TiledEnvironment(const std::string &directory, unsigned int maxCachedTiles = 64, int activeRadius = 1,
+					 double lookAhead = 3.);
+
+	/**
+	 * @brief ~TiledEnvironment Stops the prefetch thread
+	 */
+	~TiledEnvironment();
+
+	/**
+	 * @brief build Split an environment into tiles and write them to a directory
+	 * @param cylinders Cylinders of the environment
+	 * @param directory Directory to write, created if needed
+	 * @param tileSize Side of a tile
+	 * @return true if every file was written
+	 */
+	static bool build(const std::vector<Ecylinder> &cylinders, const std::string &directory, float tileSize);
+
+	/**
+	 * @brief isOpen Tells if the directory holds a tiled environment
+	 * @return true if the index of the tiles was read
+	 */
+	bool isOpen() const;
+
+	/**
+	 * @brief pollDelta Update the active tiles from the position of the drone, and ask for the tiles ahead of it
+	 * @param x,y Position of the drone
+	 * @param vx,vy Velocity of the drone
+	 * @param delta Cylinders which entered and left the active tiles
+	 * @return true if the active cylinders changed
+	 */
+	bool pollDelta(double x, double y, double vx, double vy, EnvironmentDelta &delta);
+
+	/**
+	 * @brief getStatistics Get the activity of the cache since the start
+	 * @return the statistics
+	 */
+	TileStatistics getStatistics();
+
+	float getTileSize() const;
+
+private:
+	/**
+	 * @brief tileFile Name of the file of a tile
+	 */
+	static std::string tileFile(const std::string &directory, int i, int j);
+
+	/**
+	 * @brief load Read a tile from its file, without the lock
+	 * @param key Key of the tile
+	 * @return the tile, empty if there is no file
+	 */
+	EnvironmentPtr load(int64_t key) const;
+
+	/**
+	 * @brief insert Put a tile in the cache, evicting the least recently used ones. The lock must be held.
+	 */
+	void insert(int64_t key, const EnvironmentPtr &tile, double loadTime);
+
+	/**
+	 * @brief run Loop of the prefetch thread
+	 */
+	void run();
+
+	static int64_t tileKey(int i, int j);
+	int tileIndex(double coordinate) const;
+
+	std::string directory;
+	float tileSize;
+	unsigned int maxCachedTiles;
+	int activeRadius;
+	double lookAhead;
+
+	std::unordered_map<int64_t, std::pair<EnvironmentPtr, std::list<int64_t>::iterator> > cache;
+	std::list<int64_t> recentlyUsed;                // Keys of the cached tiles, most recently used first
+	std::vector<int64_t> prefetchQueue;             // Tiles the thread must load
+	std::vector<int64_t> activeTiles;
+	std::unordered_map<int64_t, std::vector<unsigned int> > activeTileIds;   // Cylinders of each active tile
+	std::unordered_map<unsigned int, unsigned int> activeIds;   // Number of active tiles holding each cylinder
+	TileStatistics statistics;
+	double totalLoadTime;
+	unsigned long nbLoads;
+
+	std::mutex mutex;                               // Protects the cache, the queue and the statistics
+	std::condition_variable condition;
+	std::atomic<bool> running;
+	std::thread thread;
+};
+
+#endif // TILEDENVIRONMENT_H
@@ -0,0 +1,53 @@
+#ifndef TWORATESCHEDULER_H
+#define TWORATESCHEDULER_H
+
+#include <functional>
+
+/**
+ * @brief The TwoRateScheduler class runs a fast inner task and a slow outer task on a common clock. When the caller
+ * advances the clock, the scheduler runs every tick due since the last call, each at its own time, the outer task
+ * running before the inner tick of the same time. Ticks are counted from the start, so that periods do not drift.
+ */
+class TwoRateScheduler
+{
+public:
+	typedef std::function<void(double)> Task;
+
+	/**
+	 * @brief TwoRateScheduler
+	 * @param innerPeriod Period of the inner task
+	 * @param outerPeriod Period of the outer task, rounded to a multiple of the inner period
+	 * @param start Time of the first ticks
+	 */
+	TwoRateScheduler(double innerPeriod, double outerPeriod, double start = 0.);
+
+	/**
+	 * @brief advance Run the tasks due up to a given time
+	 * @param t Time reached by the clock
+	 * @param inner Inner task, called with the time of the tick
+	 * @param outer Outer task, called with the time of the tick
+	 * @return the number of inner ticks run
+	 */
+	unsigned int advance(double t, const Task &inner, const Task &outer);
+
+	/**
+	 * @brief getTime Get the time of the last inner tick run
+	 * @return the time
+	 */
+	double getTime() const;
+
+	double getInnerPeriod() const;
+	double getOuterPeriod() const;
+
+	unsigned long getInnerTicks() const;
+	unsigned long getOuterTicks() const;
+
+private:
+	double innerPeriod;
+	unsigned int ratio;                     // Number of inner ticks per outer tick
+	double start;
+	unsigned long innerTicks;               // Number of ticks run
+	unsigned long outerTicks;
+};
+
+#endif // TWORATESCHEDULER_H
@@ -3,7 +3,11 @@
 
 #include "gepetto/viewer/corba/client.hh"
 #include <string>
-#include "environmentparser.h"
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include "environment.h"
 
 using namespace graphics;
 using namespace corbaServer;
@@ -12,14 +16,14 @@ using namespace std;
 typedef CORBA::ULong WindowID;
 
 
-enum class Axis
-{
-	X,Y,Z
-};
-
 /**
  * @brief The Viewer class is an interface to the Gepetto server. It provides methods to initialise the client, drone
  * and cylinders. It also provides a method to move the drone and display an arrow next to the drone.
+ *
+ * The number of gepetto nodes does not depend on the size of the environment. Only the cylinders within the detail
+ * radius around the drone are drawn, on a pool of at most maxNodes unit cylinders which are scaled, moved and reused as
+ * the drone flies. Static cylinders are sorted in a grid of cubic cells: the cells farther than the detail radius, up to
+ * the impostor radius, are each drawn as a single box around their cylinders, from a pool of at most maxImpostors boxes.
  */
 class Viewer
 {
@@ -30,16 +34,68 @@ public:
 	Viewer();
 
 	/**
-	 * @brief createEnvironment Create gepetto cylinders and draw them for each set of coordinates in cylinder_list
-	 * @param cylinder_list List of cylinders to create
+	 * @brief createEnvironment Create gepetto cylinders and draw them for each obstacle of an environment
+	 * @param environment Environment to draw, whose obstacles are shared with the viewer
+	 */
+	void createEnvironment(const Environment &environment);
+
+	/**
+	 * @brief setLevelOfDetail Change the distances and the bounds on the number of nodes used to draw the environment
+	 * @param detailRadius Distance under which the cylinders are drawn
+	 * @param impostorRadius Distance under which the cells of cylinders are drawn as boxes
+	 * @param maxNodes Largest number of cylinders drawn
+	 * @param maxImpostors Largest number of boxes drawn
+	 */
+	void setLevelOfDetail(float detailRadius, float impostorRadius, unsigned int maxNodes, unsigned int maxImpostors);
+
+	/**
+	 * @brief addObstacles Create gepetto cylinders for new obstacles, after createEnvironment
+	 * @param obstacles List of obstacles to create
 	 */
-	void createEnvironment(const std::vector<Ecylinder> &cylinder_list);
+	void addObstacles(const std::vector<ObstaclePtr> &obstacles);
 
 	/**
-	 * @brief createDrone Create and initialise drone in gepetto
+	 * @brief removeObstacles Hide the gepetto cylinders of removed obstacles
+	 * @param ids Ids of the cylinders to remove
+	 */
+	void removeObstacles(const std::vector<unsigned int> &ids);
+
+	/**
+	 * @brief updateObstacles Choose the cylinders to draw around the drone and move the moving ones to their position at
+	 * time t, at most every OBSTACLES_UPDATE_PERIOD seconds. The boxes are updated once the drone has moved by a quarter
+	 * of a cell. The scene is refreshed by moveDrone.
+	 * @param t Time in seconds
+	 */
+	void updateObstacles(double t);
+
+	/**
+	 * @brief createDrone Create and initialise drone in gepetto. The mesh is loaded once, and STL meshes are first
+	 * decimated, the result being cached (see StlMesh::cached).
 	 * @param filename Mesh file to load for the drone
+	 * @param decimation Size of the cells of the decimation in meters, 0 to load the mesh as it is
+	 * @return true if the mesh was loaded
+	 */
+	bool createDrone(const char* filename, float decimation = DRONE_DECIMATION);
+
+	/**
+	 * @brief addDrone Create another drone, instancing the mesh loaded by createDrone
+	 * @param name Name of the drone
+	 * @return true if the drone was created
 	 */
-	void createDrone(const char* filename);
+	bool addDrone(const std::string &name);
+
+	/**
+	 * @brief placeDrone Set the position of a drone created by addDrone
+	 * @param name Name of the drone
+	 * @param x
+	 * @param y
+	 * @param z
+	 * @param qw
+	 * @param qx
+	 * @param qy
+	 * @param qz
+	 */
+	void placeDrone(const std::string &name, double x, double y, double z, double qw, double qx, double qy, double qz);
 
 	/**
 	 * @brief moveDrone Set the drone's new position in space, using cartesian coordinates and roll-pitch-yaw angles
@@ -51,6 +107,19 @@ public:
 	 */
 	void moveDrone(double x, double y, double z, double roll, double pitch, double yaw);
 
+	/**
+	 * @brief moveDrone Set the drone's new position in space, using cartesian coordinates and the quaternion of the
+	 * rotation from the body frame to the world frame
+	 * @param x
+	 * @param y
+	 * @param z
+	 * @param qw
+	 * @param qx
+	 * @param qy
+	 * @param qz
+	 */
+	void moveDrone(double x, double y, double z, double qw, double qx, double qy, double qz);
+
 	/**
 	 * @brief setArrow Sets the arrow's direction according the the speed commands in cartesian coordinates
 	 * @param vx
@@ -63,15 +132,119 @@ private:
 	ClientCpp client;
 	WindowID w_id;
 	se3::SE3 se3Drone;
-	std::vector<Ecylinder> cylinders;
+	bool droneLoaded;                                       // The drone mesh is loaded and can be instanced
+	/**
+	 * @brief The CylinderNode struct is a cylinder known by the viewer. Its geometry is the one of the shared obstacle.
+	 */
+	struct CylinderNode
+	{
+		ObstaclePtr obstacle;
+		int slot;                           // Index of the gepetto node drawing it, -1 if it is not drawn
+	};
+
+	/**
+	 * @brief The Cell struct is a cube of the grid of static cylinders
+	 */
+	struct Cell
+	{
+		std::vector<unsigned int> ids;      // Cylinders whose center is in the cell
+		Eigen::Vector3f min, max;           // Bounding box of the cylinders
+		int impostor;                       // Index of the gepetto box drawing it, -1 if it is not drawn
+	};
+
+	/**
+	 * @brief The Pool struct is a set of gepetto nodes, created when needed and hidden when released
+	 */
+	struct Pool
+	{
+		std::vector<std::string> names;     // Names of the nodes created
+		std::vector<unsigned int> free;     // Indices of the hidden nodes
+	};
+
+	std::map<unsigned int, CylinderNode> nodes;             // Cylinders by id
+	std::unordered_map<int64_t, Cell> cells;                // Cells of the static cylinders, by key
+	std::vector<unsigned int> movingCylinders;              // Ids of the cylinders which are not static
+	std::vector<unsigned int> drawnCylinders;               // Ids of the cylinders drawn
+	std::vector<int64_t> drawnCells;                        // Keys of the cells drawn as boxes
+	Pool cylinderPool;
+	Pool impostorPool;
+	std::vector<std::pair<float,unsigned int> > candidates; // Buffer used to choose the cylinders to draw
+	std::vector<std::pair<float,int64_t> > cellCandidates;  // Buffer used to choose the cells to draw
+	std::vector<int64_t> detailedCells;                     // Sorted keys of the cells whose cylinders are all drawn
+	std::vector<int64_t> cellsBuffer;                       // Buffer used to choose the cells drawn in detail
+	Eigen::Vector3f dronePosition;                          // Last position given to moveDrone
+	Eigen::Vector3f impostorsPosition;                      // Position of the drone at the last update of the boxes
+	bool impostorsDirty;                                    // The cells changed since the last update of the boxes
+	bool detailChanged;                                     // The cells drawn in detail changed since then
+	double lastObstaclesUpdate;                     // Time of the last update of the moving cylinders
+	float detailRadius, impostorRadius;
+	unsigned int maxNodes, maxImpostors;
+
+	static constexpr double OBSTACLES_UPDATE_PERIOD = 0.05;
+	static constexpr float DRONE_DECIMATION = 0.02f;
+	static constexpr const char *DRONE_MESH_NODE = "drone_mesh";  // Not in a group, the drones are its only parents
+	static constexpr float CELL_SIZE = 25.f;
+
+	/**
+	 * @brief centerOn Move the world so that the camera stays centered on the drone
+	 * @param x
+	 * @param y
+	 * @param z
+	 */
+	void centerOn(double x, double y, double z);
+
+	/**
+	 * @brief cylinderPosition Computes the configuration of a cylinder in the environment group
+	 * @param node Cylinder
+	 * @param t Time in seconds
+	 * @return the configuration of the cylinder
+	 */
+	se3::SE3 cylinderPosition(const CylinderNode &node, double t) const;
+
+	/**
+	 * @brief cellIndex Index of the cell containing a coordinate
+	 */
+	static int cellIndex(float coordinate);
+
+	/**
+	 * @brief cellKey Key of a cell in the grid
+	 */
+	static int64_t cellKey(int i, int j, int k);
+
+	/**
+	 * @brief updateBounds Computes the bounding box of the cylinders of a cell
+	 * @param cell Cell to update
+	 */
+	void updateBounds(Cell &cell);
+
+	/**
+	 * @brief cellDistance Distance between the drone and the bounding box of a cell
+	 */
+	float cellDistance(const Cell &cell) const;
+
+	/**
+	 * @brief updateCylinders Draw the cylinders of the cells within the detail radius and the moving ones closest to the
+	 * drone, reusing the nodes of the cylinders still drawn
+	 * @param t Time in seconds
+	 */
+	void updateCylinders(double t);
+
+	/**
+	 * @brief updateImpostors Draw as boxes the cells closest to the drone within the impostor radius which are not drawn in detail
+	 */
+	void updateImpostors();
+
+	/**
+	 * @brief hideCylinder Release the node drawing a cylinder
+	 * @param node Cylinder
+	 */
+	void hideCylinder(CylinderNode &node);
 
 	/**
-	 * @brief rotationMat Builds a rotation matrix from an angle and an axis
-	 * @param angle Angle in radian
-	 * @param axis Axis of rotation. Can be either of Axis::X, Axis::Y, Axis::Z
-	 * @return the rotation matrix
+	 * @brief hideImpostor Release the box drawing a cell
+	 * @param cell Cell
 	 */
-	Eigen::Matrix3d rotationMat(double angle, Axis axis);
+	void hideImpostor(Cell &cell);
 };
 
 #endif
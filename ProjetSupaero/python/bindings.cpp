@@ -0,0 +1,316 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Python bindings of the environment, the simulated drone, the MPC and the viewer, for batches of experiments driven
+// from Python. The arrays of states, controls and cylinders are NumPy views on the memory of the C++ objects, which
+// stay alive as long as the views. The GIL is released while the solver and the simulation step, so that Python threads
+// run simulations in parallel.
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <acado_toolkit.hpp>
+#include <acado_optimal_control.hpp>
+
+#include "environment.h"
+#include "mpcsolver.h"
+#include "dronemodel.h"
+#include "viewer.h"
+
+namespace py = pybind11;
+USING_NAMESPACE_ACADO;
+
+namespace
+{
+    /**
+     * @brief view Array on memory owned by a Python object, which the array keeps alive
+     */
+    template <typename T>
+    py::array_t<T> view(py::handle owner, T *data, std::vector<ssize_t> shape, bool writable)
+    {
+        std::vector<ssize_t> strides(shape.size(), sizeof(T));
+        for (int i = (int)shape.size()-2; i >= 0; i--)
+            strides[i] = strides[i+1]*shape[i+1];
+
+        py::array_t<T> array(shape, strides, data, owner);
+        if (!writable)
+            array.attr("setflags")(py::arg("write") = false);
+        return array;
+    }
+
+    /**
+     * @brief The PyEnvironment struct is an environment seen from Python. The obstacles are allocated one by one, so
+     * their data is gathered once in contiguous tables, which the arrays view.
+     */
+    struct PyEnvironment
+    {
+        explicit PyEnvironment(const EnvironmentPtr &environment): environment(environment)
+        {
+            for (const ObstaclePtr &o : environment->getObstacles())
+            {
+                const Ecylinder &c = o->cylinder;
+                const Eshape &s = o->shape;
+                ids.push_back(c.id);
+                cylinders.insert(cylinders.end(), {c.x1, c.y1, c.z1, c.x2, c.y2, c.z2, c.radius, c.vx, c.vy, c.vz});
+                shapes.insert(shapes.end(), {s.axis.x, s.axis.y, s.axis.z, s.length,
+                                             s.min.x, s.min.y, s.min.z, s.max.x, s.max.y, s.max.z});
+            }
+        }
+
+        EnvironmentPtr environment;
+        std::vector<unsigned int> ids;
+        std::vector<float> cylinders;       // x1 y1 z1 x2 y2 z2 radius vx vy vz, one row per cylinder
+        std::vector<float> shapes;          // axis, length, min and max of the bounding box, one row per cylinder
+    };
+
+    const ssize_t CYLINDER_COLUMNS = 10, SHAPE_COLUMNS = 10;
+
+    /**
+     * @brief The Plant struct simulates the drone with the model of a solver
+     */
+    struct Plant
+    {
+        explicit Plant(const MPCSolver &solver):
+            system(solver.getModel(), OutputFcn{}),
+            process(system, INT_RK45),
+            x(solver.getNbStates()),
+            u(MPCSolver::NB_CONTROLS),
+            t(0.)
+        {
+            // at rest at the origin, the propellers of the actuator model at hover speed
+            x.setZero();
+            if (solver.getNbDroneStates() == MPCSolver::NB_STATES_QUATERNION)
+                x(6) = 1.;
+            for (unsigned int i = solver.getNbDroneStates(); i < solver.getNbStates(); i++)
+                x(i) = DroneModel::hoverSpeed();
+            u.setZero();
+        }
+
+        void reset(double t)
+        {
+            this->t = t;
+            process.init(t, x, u);
+        }
+
+        void step(double dt)
+        {
+            process.step(t, t+dt, u);
+            process.getY(y);
+            // the views on x stay valid, its storage is never reallocated
+            DVector last = y.getLastVector();
+            for (unsigned int i = 0; i < x.getDim(); i++)
+                x(i) = last(i);
+            t += dt;
+        }
+
+        DynamicSystem system;
+        Process process;
+        DVector x, u;
+        VariablesGrid y;
+        double t;
+    };
+
+    /**
+     * @brief The Solver struct is a MPCSolver with the buffers of its state and of its command
+     */
+    struct Solver
+    {
+        explicit Solver(const MPCParameters &parameters):
+            mpc(parameters),
+            x(mpc.getNbStates()),
+            u(MPCSolver::NB_CONTROLS)
+        {
+            x.setZero();
+            u.setZero();
+        }
+
+        void setState(py::array_t<double, py::array::c_style | py::array::forcecast> state)
+        {
+            if (state.ndim() != 1 || state.shape(0) != (ssize_t)x.getDim())
+                throw std::invalid_argument("the state must have " + std::to_string(x.getDim()) + " values");
+            for (unsigned int i = 0; i < x.getDim(); i++)
+                x(i) = state.data()[i];
+        }
+
+        bool step(double t, const DVector &state)
+        {
+            bool success;
+            {
+                py::gil_scoped_release release;
+                success = mpc.step(t, state);
+                if (success)
+                    mpc.getU(u);
+            }
+            return success;
+        }
+
+        MPCSolver mpc;
+        DVector x, u;
+    };
+
+    py::array_t<double> gridToArray(const VariablesGrid &grid)
+    {
+        py::array_t<double> array({(ssize_t)grid.getNumPoints(), (ssize_t)grid.getNumValues()});
+        auto a = array.mutable_unchecked<2>();
+        for (unsigned int i = 0; i < grid.getNumPoints(); i++)
+            for (unsigned int j = 0; j < grid.getNumValues(); j++)
+                a(i, j) = grid(i, j);
+        return array;
+    }
+}
+
+
+PYBIND11_MODULE(projectsupaero, m)
+{
+    m.doc() = "Drone simulation and MPC of ProjectSupaero";
+
+    m.def("hover_speed", &DroneModel::hoverSpeed, "Velocity of each propeller to keep the drone still");
+
+    py::class_<PyEnvironment>(m, "Environment")
+        .def_static("load", [](const std::string &filename)
+        {
+            EnvironmentParser parser(filename);
+            if (!parser.isLoaded())
+                throw std::runtime_error("cannot load " + filename);
+            return PyEnvironment(parser.readEnvironment());
+        }, py::arg("filename"), "Load an XML environment file")
+        .def("__len__", [](const PyEnvironment &e) { return e.ids.size(); })
+        .def_property_readonly("ids", [](py::object self)
+        {
+            PyEnvironment &e = self.cast<PyEnvironment &>();
+            return view(self, e.ids.data(), {(ssize_t)e.ids.size()}, false);
+        })
+        .def_property_readonly("cylinders", [](py::object self)
+        {
+            PyEnvironment &e = self.cast<PyEnvironment &>();
+            return view(self, e.cylinders.data(), {(ssize_t)e.ids.size(), CYLINDER_COLUMNS}, false);
+        }, "x1 y1 z1 x2 y2 z2 radius vx vy vz of each cylinder")
+        .def_property_readonly("shapes", [](py::object self)
+        {
+            PyEnvironment &e = self.cast<PyEnvironment &>();
+            return view(self, e.shapes.data(), {(ssize_t)e.ids.size(), SHAPE_COLUMNS}, false);
+        }, "unit axis, length and bounding box (min, max) of each cylinder");
+
+    py::enum_<ObstacleConstraints>(m, "ObstacleConstraints")
+        .value("CYLINDERS", ObstacleConstraints::CYLINDERS)
+        .value("CORRIDOR", ObstacleConstraints::CORRIDOR);
+
+    py::enum_<AttitudeModel>(m, "AttitudeModel")
+        .value("EULER_ANGLES", AttitudeModel::EULER_ANGLES)
+        .value("QUATERNION", AttitudeModel::QUATERNION);
+
+    py::class_<MPCParameters>(m, "MPCParameters")
+        .def(py::init<>())
+        .def_static("long_horizon", &MPCParameters::longHorizon)
+        .def_static("actuated", &MPCParameters::actuated)
+        .def_readwrite("nb_intervals", &MPCParameters::nbIntervals)
+        .def_readwrite("nb_obstacle_slots", &MPCParameters::nbObstacleSlots)
+        .def_readwrite("obstacle_constraints", &MPCParameters::obstacleConstraints)
+        .def_readwrite("attitude", &MPCParameters::attitude)
+        .def_readwrite("actuator_dynamics", &MPCParameters::actuatorDynamics)
+        .def_readwrite("vu_max", &MPCParameters::vuMax)
+        .def_readwrite("soft_constraints", &MPCParameters::softConstraints)
+        .def_readwrite("slack_penalty", &MPCParameters::slackPenalty)
+        .def_readwrite("horizon", &MPCParameters::horizon)
+        .def_readwrite("weights", &MPCParameters::weights)
+        .def_readwrite("u_min", &MPCParameters::uMin)
+        .def_readwrite("u_max", &MPCParameters::uMax)
+        .def_readwrite("safety_margin", &MPCParameters::safetyMargin);
+
+    // the problems are built with the GIL held, ACADO builds its symbolic expressions in global state
+    py::class_<Solver>(m, "MPCSolver")
+        .def(py::init<const MPCParameters &>(), py::arg("parameters") = MPCParameters())
+        .def_property_readonly("nb_states", [](const Solver &s) { return s.mpc.getNbStates(); })
+        .def("set_obstacles", [](Solver &s, const PyEnvironment &e) { s.mpc.setObstacles(*e.environment); })
+        .def("init", [](Solver &s, double t, py::array_t<double, py::array::c_style | py::array::forcecast> state)
+        {
+            s.setState(state);
+            s.mpc.init(t, s.x);
+        }, py::arg("t"), py::arg("state"))
+        .def("set_reference", [](Solver &s, double t, py::array_t<double, py::array::c_style | py::array::forcecast> points)
+        {
+            // same time grid as ProjectSupaero, the points of the reference span one second
+            if (points.ndim() != 2 || points.shape(1) != (ssize_t)MPCSolver::NB_OUTPUTS || points.shape(0) < 2)
+                throw std::invalid_argument("the reference must have at least 2 rows of 10 values");
+            VariablesGrid reference(MPCSolver::NB_OUTPUTS, Grid{t, t+1., (unsigned int)points.shape(0)});
+            for (ssize_t i = 0; i < points.shape(0); i++)
+                reference.setVector(i, DVector(MPCSolver::NB_OUTPUTS, points.data(i, 0)));
+            s.mpc.setReference(reference);
+        }, py::arg("t"), py::arg("points"), "Reference of the outputs, one row of 10 values per point")
+        .def("step", [](Solver &s, double t, py::array_t<double, py::array::c_style | py::array::forcecast> state)
+        {
+            s.setState(state);
+            return s.step(t, s.x);
+        }, py::arg("t"), py::arg("state"), "Solve one step from a state, without the GIL")
+        .def("step", [](Solver &s, double t, const Plant &plant) { return s.step(t, plant.x); },
+             py::arg("t"), py::arg("plant"), "Solve one step from the state of a plant, without copy nor GIL")
+        .def_property_readonly("controls", [](py::object self)
+        {
+            Solver &s = self.cast<Solver &>();
+            return view(self, s.u.data(), {(ssize_t)MPCSolver::NB_CONTROLS}, false);
+        }, "Command of the last successful step, updated in place")
+        .def_property_readonly("obstacle_slack", [](const Solver &s) { return s.mpc.getObstacleSlack(); })
+        .def_property_readonly("attitude_slack", [](const Solver &s) { return s.mpc.getAttitudeSlack(); })
+        .def("prediction", [](const Solver &s)
+        {
+            VariablesGrid states, controls;
+            s.mpc.getPrediction(states, controls);
+            return py::make_tuple(gridToArray(states), gridToArray(controls));
+        }, "States and controls optimised by the last step, copied");
+
+    py::class_<Plant>(m, "Plant")
+        .def(py::init([](const Solver &s) { return new Plant(s.mpc); }), py::arg("solver"),
+             "Simulated drone with the model of a solver")
+        .def_property_readonly("state", [](py::object self)
+        {
+            Plant &p = self.cast<Plant &>();
+            return view(self, p.x.data(), {(ssize_t)p.x.getDim()}, true);
+        }, "State of the drone, updated in place")
+        .def_property_readonly("controls", [](py::object self)
+        {
+            Plant &p = self.cast<Plant &>();
+            return view(self, p.u.data(), {(ssize_t)MPCSolver::NB_CONTROLS}, true);
+        }, "Command applied by step")
+        .def_readonly("t", &Plant::t)
+        .def("reset", &Plant::reset, py::arg("t") = 0., "Start the simulation from the current state")
+        .def("step", &Plant::step, py::arg("dt"), py::call_guard<py::gil_scoped_release>(),
+             "Simulate the drone under its command, without the GIL");
+
+    py::class_<Viewer>(m, "Viewer")
+        .def(py::init<>(), "Connect to the gepetto server")
+        .def("create_environment", [](Viewer &v, const PyEnvironment &e) { v.createEnvironment(*e.environment); })
+        .def("create_drone", [](Viewer &v, const std::string &filename, float decimation)
+        {
+            return v.createDrone(filename.c_str(), decimation);
+        }, py::arg("filename"), py::arg("decimation") = 0.02f)
+        .def("move_drone", (void (Viewer::*)(double, double, double, double, double, double)) &Viewer::moveDrone,
+             py::arg("x"), py::arg("y"), py::arg("z"), py::arg("roll"), py::arg("pitch"), py::arg("yaw"))
+        .def("move_drone", (void (Viewer::*)(double, double, double, double, double, double, double)) &Viewer::moveDrone,
+             py::arg("x"), py::arg("y"), py::arg("z"), py::arg("qw"), py::arg("qx"), py::arg("qy"), py::arg("qz"))
+        .def("update_obstacles", &Viewer::updateObstacles, py::arg("t"));
+}
@@ -0,0 +1,58 @@
+#!/usr/bin/env python
+#
+# Copyright 2015 CNRS
+# Authors : Mathieu Geisert - Florian Valenza
+#
+# Flies the drone forward at several speeds, one thread per flight, and prints the final position of each flight.
+#   sweep.py <environment.xml> [duration]
+
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+import projectsupaero as ps
+
+DT = 0.02
+
+
+def fly(solver, plant, speed, duration):
+    plant.reset(0.)
+    solver.init(0., plant.state)
+
+    # outputs vx vy vz, propeller velocities and p q r: forward at the given speed, propellers at hover
+    reference = np.zeros((ps.MPCParameters().nb_intervals + 1, 10))
+    reference[:, 0] = speed
+    reference[:, 3:7] = ps.hover_speed()
+    steps = int(duration / DT)
+    for i in range(steps):
+        t = i * DT
+        solver.set_reference(t, reference)
+        if solver.step(t, plant):
+            plant.controls[:] = solver.controls
+        plant.step(DT)
+    return plant.state[:3].copy()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: sweep.py <environment.xml> [duration]")
+        return 1
+    environment = ps.Environment.load(sys.argv[1])
+    duration = float(sys.argv[2]) if len(sys.argv) > 2 else 10.
+    speeds = [0.5, 1., 1.5, 2.]
+
+    # the solvers and their plants are built here, one at a time, the threads only step them
+    solvers = [ps.MPCSolver() for v in speeds]
+    plants = []
+    for solver in solvers:
+        solver.set_obstacles(environment)
+        plants.append(ps.Plant(solver))
+    with ThreadPoolExecutor(len(speeds)) as pool:
+        positions = pool.map(lambda s, p, v: fly(s, p, v, duration), solvers, plants, speeds)
+        for speed, position in zip(speeds, positions):
+            print("speed %.1f m/s: final position %s" % (speed, position))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
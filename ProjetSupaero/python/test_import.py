@@ -0,0 +1,40 @@
+#!/usr/bin/env python
+#
+# Copyright 2015 CNRS
+# Authors : Mathieu Geisert - Florian Valenza
+#
+# Smoke test of the Python module: imports it, loads an environment and flies one step.
+#   test_import.py <environment.xml>
+
+import sys
+
+import numpy as np
+import projectsupaero as ps
+
+
+def main():
+    environment = ps.Environment.load(sys.argv[1])
+    assert environment.cylinders.shape == (len(environment), 10)
+    assert not environment.cylinders.flags.writeable
+
+    solver = ps.MPCSolver()
+    solver.set_obstacles(environment)
+    plant = ps.Plant(solver)
+    plant.state[2] = 4.
+    plant.reset(0.)
+    solver.init(0., plant.state)
+
+    reference = np.zeros((ps.MPCParameters().nb_intervals + 1, 10))
+    reference[:, 3:7] = ps.hover_speed()
+    solver.set_reference(0., reference)
+    assert solver.step(0., plant)
+    assert not solver.controls.flags.writeable
+    plant.controls[:] = solver.controls
+    plant.step(0.02)
+    assert plant.t > 0. and np.all(np.isfinite(plant.state))
+    print("ok")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
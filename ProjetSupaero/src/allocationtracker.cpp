@@ -0,0 +1,151 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "allocationtracker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <execinfo.h>
+#include <unistd.h>
+
+namespace
+{
+    struct Record
+    {
+        unsigned long size;
+        int depth;
+        void *frames[AllocationTracker::MAX_FRAMES];
+    };
+
+    // State of a thread, plain data so that it needs no constructor, in the static TLS block so that reading it never
+    // allocates. This object is only linked into executables, whose TLS is always static.
+    struct Tracking
+    {
+        bool enabled;
+        bool inHook;                        // backtrace may allocate, its own allocations are not recorded
+        unsigned long count;
+        unsigned long bytes;
+        unsigned int nbRecords;
+        Record records[AllocationTracker::MAX_RECORDS];
+    };
+
+    __thread Tracking tracking __attribute__((tls_model("initial-exec")));
+
+    void writeString(int fd, const char *buffer, int length)
+    {
+        if (length > 0 && write(fd, buffer, length) < 0)
+            return;
+    }
+}
+
+
+void AllocationTracker::start()
+{
+    // the first backtrace loads the unwinder, which must not happen while tracking
+    void *frame;
+    tracking.inHook = true;
+    backtrace(&frame, 1);
+    tracking.inHook = false;
+
+    tracking.count = 0;
+    tracking.bytes = 0;
+    tracking.nbRecords = 0;
+    tracking.enabled = true;
+}
+
+unsigned long AllocationTracker::stop()
+{
+    tracking.enabled = false;
+    return tracking.count;
+}
+
+unsigned long AllocationTracker::getCount()
+{
+    return tracking.count;
+}
+
+unsigned long AllocationTracker::getBytes()
+{
+    return tracking.bytes;
+}
+
+void AllocationTracker::report(int fd)
+{
+    char buffer[128];
+    for (unsigned int i = 0; i < tracking.nbRecords; i++)
+    {
+        const Record &r = tracking.records[i];
+        writeString(fd, buffer, snprintf(buffer, sizeof(buffer), "allocation of %lu bytes:\n", r.size));
+        // the first frames are record and operator new
+        if (r.depth > 2)
+            backtrace_symbols_fd(r.frames + 2, r.depth - 2, fd);
+    }
+    if (tracking.count > tracking.nbRecords)
+        writeString(fd, buffer, snprintf(buffer, sizeof(buffer), "%lu more allocations\n", tracking.count - tracking.nbRecords));
+}
+
+// not inlined, so that the first two frames of a backtrace are always record and operator new
+__attribute__((noinline)) void AllocationTracker::record(unsigned long size)
+{
+    if (!tracking.enabled || tracking.inHook)
+        return;
+
+    tracking.inHook = true;
+    tracking.count++;
+    tracking.bytes += size;
+    if (tracking.nbRecords < MAX_RECORDS)
+    {
+        Record &r = tracking.records[tracking.nbRecords++];
+        r.size = size;
+        r.depth = backtrace(r.frames, MAX_FRAMES);
+    }
+    tracking.inHook = false;
+}
+
+
+// Replacements of the global operator new, the default operator delete frees the memory with free
+
+void *operator new(std::size_t size)
+{
+    AllocationTracker::record(size);
+    void *p = std::malloc(size > 0 ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    AllocationTracker::record(size);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return operator new(size, std::nothrow);
+}
@@ -0,0 +1,118 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include <algorithm>
+#include "dronemodel.h"
+
+namespace DroneModel
+{
+
+State dynamics(const State &x, const Command &u)
+{
+    double phi = x(6), theta = x(7), psi = x(8);
+    double p = x(9), q = x(10), r = x(11);
+    double u1 = u(0)*u(0), u2 = u(1)*u(1), u3 = u(2)*u(2), u4 = u(3)*u(3);
+    double thrust = Cf*(u1+u2+u3+u4);
+
+    State dx;
+    dx(0) = x(3);
+    dx(1) = x(4);
+    dx(2) = x(5);
+    dx(3) = thrust*sin(theta)/m;
+    dx(4) = -thrust*sin(psi)*cos(theta)/m;
+    dx(5) = thrust*cos(psi)*cos(theta)/m - g;
+    dx(6) = -cos(phi)*tan(theta)*p+sin(phi)*tan(theta)*q+r;
+    dx(7) = sin(phi)*p+cos(phi)*q;
+    dx(8) = cos(phi)/cos(theta)*p-sin(phi)/cos(theta)*q;
+    dx(9) = (d*Cf*(u1-u2)+(Jy-Jz)*q*r)/Jx;
+    dx(10) = (d*Cf*(u4-u3)+(Jz-Jx)*p*r)/Jy;
+    dx(11) = (c*(u1+u2-u3-u4)+(Jx-Jy)*p*q)/Jz;
+    return dx;
+}
+
+State integrate(const State &x, const Command &u, double dt)
+{
+    State k1 = dynamics(x, u);
+    State k2 = dynamics(x + dt/2.*k1, u);
+    State k3 = dynamics(x + dt/2.*k2, u);
+    State k4 = dynamics(x + dt*k3, u);
+    return x + dt/6.*(k1 + 2.*k2 + 2.*k3 + k4);
+}
+
+void linearise(const State &x, const Command &u, StateMatrix &A, CommandMatrix &B)
+{
+    const double h = 1e-6;
+
+    for (int i = 0; i < 12; i++)
+    {
+        State dx = State::Zero();
+        dx(i) = h;
+        A.col(i) = (dynamics(x + dx, u) - dynamics(x - dx, u))/(2.*h);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        Command du = Command::Zero();
+        du(i) = h;
+        B.col(i) = (dynamics(x, u + du) - dynamics(x, u - du))/(2.*h);
+    }
+}
+
+Eigen::Quaterniond attitude(double phi, double theta, double psi)
+{
+    return Eigen::AngleAxisd(psi, Eigen::Vector3d::UnitX())
+         * Eigen::AngleAxisd(theta, Eigen::Vector3d::UnitY())
+         * Eigen::AngleAxisd(phi, Eigen::Vector3d::UnitZ());
+}
+
+Eigen::Vector3d eulerAngles(const Eigen::Quaterniond &q)
+{
+    Eigen::Matrix3d R = q.normalized().toRotationMatrix();
+    return Eigen::Vector3d(atan2(-R(0,1), R(0,0)),
+                           asin(std::min(1., std::max(-1., R(0,2)))),
+                           atan2(-R(1,2), R(2,2)));
+}
+
+QuaternionState toQuaternionState(const State &x)
+{
+    QuaternionState xq;
+    Eigen::Quaterniond q = attitude(x(6), x(7), x(8));
+    xq.head<6>() = x.head<6>();
+    xq(6) = q.w();
+    xq(7) = q.x();
+    xq(8) = q.y();
+    xq(9) = q.z();
+    xq.tail<3>() = x.tail<3>();
+    return xq;
+}
+
+State toEulerState(const QuaternionState &x)
+{
+    State xe;
+    xe.head<6>() = x.head<6>();
+    xe.segment<3>(6) = eulerAngles(Eigen::Quaterniond(x(6), x(7), x(8), x(9)));
+    xe.tail<3>() = x.tail<3>();
+    return xe;
+}
+
+}
@@ -0,0 +1,111 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+#include "environment.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Geometry of a cylinder at time 0
+    Eshape shapeOf(const Ecylinder &c)
+    {
+        Eshape s;
+        float dx = c.x2-c.x1, dy = c.y2-c.y1, dz = c.z2-c.z1;
+        s.center = {(c.x1+c.x2)/2.f, (c.y1+c.y2)/2.f, (c.z1+c.z2)/2.f};
+        s.length = std::sqrt(dx*dx+dy*dy+dz*dz);
+        if (s.length > 0.f)
+            s.axis = {dx/s.length, dy/s.length, dz/s.length};
+        else
+            s.axis = {0.f, 0.f, 1.f};
+
+        // same rotation as PoseMath::axisOrientation, Rz(atan2(dy,dx))*Ry(atan2(sqrt(dx^2+dy^2),dz))
+        float a = std::atan2(dy, dx) / 2.f;
+        float b = std::atan2(std::sqrt(dx*dx+dy*dy), dz) / 2.f;
+        float ca = std::cos(a), sa = std::sin(a), cb = std::cos(b), sb = std::sin(b);
+        s.orientation[0] = ca*cb;
+        s.orientation[1] = -sa*sb;
+        s.orientation[2] = ca*sb;
+        s.orientation[3] = sa*cb;
+
+        s.min = {std::min(c.x1, c.x2) - c.radius, std::min(c.y1, c.y2) - c.radius, std::min(c.z1, c.z2) - c.radius};
+        s.max = {std::max(c.x1, c.x2) + c.radius, std::max(c.y1, c.y2) + c.radius, std::max(c.z1, c.z2) + c.radius};
+        return s;
+    }
+
+    bool lowerId(const ObstaclePtr &a, unsigned int id)
+    {
+        return a->cylinder.id < id;
+    }
+}
+
+
+Eobstacle::Eobstacle(Ecylinder &&cylinder):
+    cylinder(std::move(cylinder)),
+    shape(shapeOf(this->cylinder))
+{
+}
+
+
+EnvironmentPtr Environment::create(std::vector<Ecylinder> cylinders)
+{
+    std::vector<ObstaclePtr> obstacles;
+    obstacles.reserve(cylinders.size());
+    for (Ecylinder &c : cylinders)
+        obstacles.push_back(std::make_shared<const Eobstacle>(std::move(c)));
+
+    std::sort(obstacles.begin(), obstacles.end(),
+              [](const ObstaclePtr &a, const ObstaclePtr &b) { return a->cylinder.id < b->cylinder.id; });
+    return EnvironmentPtr(new Environment(std::move(obstacles)));
+}
+
+Environment::Environment(std::vector<ObstaclePtr> &&obstacles):
+    obstacles(std::move(obstacles))
+{
+}
+
+const std::vector<ObstaclePtr> &Environment::getObstacles() const
+{
+    return obstacles;
+}
+
+size_t Environment::size() const
+{
+    return obstacles.size();
+}
+
+ObstaclePtr Environment::find(unsigned int id) const
+{
+    auto it = std::lower_bound(obstacles.begin(), obstacles.end(), id, lowerId);
+    if (it == obstacles.end() || (*it)->cylinder.id != id)
+        return ObstaclePtr();
+    return *it;
+}
+
+size_t Environment::memoryUsage() const
+{
+    // make_shared puts the obstacle and its reference counts in a single block
+    size_t bytes = sizeof(Environment) + obstacles.capacity()*sizeof(ObstaclePtr);
+    for (const ObstaclePtr &o : obstacles)
+        bytes += sizeof(Eobstacle) + 2*sizeof(long) + o->cylinder.keyframes.capacity()*sizeof(Ekeyframe);
+    return bytes;
+}
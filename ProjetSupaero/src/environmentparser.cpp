@@ -20,7 +20,10 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
 
 #include "environmentparser.h"
+#include "environment.h"
 #include <iostream>
+#include <cstdio>
+#include <cmath>
 
 // Macro to check XMLError validity
 #ifndef XMLCheckResult
@@ -28,6 +31,73 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 
 
+bool Ecylinder::isStatic() const
+{
+    return keyframes.empty() && vx == 0.f && vy == 0.f && vz == 0.f;
+}
+
+Epoint Ecylinder::displacement(double t) const
+{
+    if (keyframes.empty())
+    {
+        Epoint d = {vx*(float)t, vy*(float)t, vz*(float)t};
+        return d;
+    }
+
+    // the trajectory is played in a loop, and stays on the first keyframe until its time
+    double period = keyframes.back().t;
+    double tLoop = period > 0. ? fmod(t, period) : 0.;
+    if (tLoop < 0.)
+        tLoop += period;
+
+    unsigned int i = 0;
+    while (i+1 < keyframes.size() && keyframes[i+1].t < tLoop)
+        i++;
+
+    const Ekeyframe &k1 = keyframes[i];
+    if (i+1 == keyframes.size() || tLoop <= k1.t)
+    {
+        Epoint d = {k1.x, k1.y, k1.z};
+        return d;
+    }
+
+    const Ekeyframe &k2 = keyframes[i+1];
+    float a = (float)(tLoop - k1.t)/(k2.t - k1.t);
+    Epoint d = {k1.x + a*(k2.x-k1.x), k1.y + a*(k2.y-k1.y), k1.z + a*(k2.z-k1.z)};
+    return d;
+}
+
+Epoint Ecylinder::velocity(double t) const
+{
+    if (keyframes.empty())
+    {
+        Epoint v = {vx, vy, vz};
+        return v;
+    }
+
+    // slope of the current segment of the trajectory
+    Epoint v = {0.f, 0.f, 0.f};
+    double period = keyframes.back().t;
+    double tLoop = period > 0. ? fmod(t, period) : 0.;
+    if (tLoop < 0.)
+        tLoop += period;
+
+    for (unsigned int i = 0; i+1 < keyframes.size(); i++)
+    {
+        const Ekeyframe &k1 = keyframes[i], &k2 = keyframes[i+1];
+        if (k1.t <= tLoop && tLoop < k2.t)
+        {
+            float dt = k2.t - k1.t;
+            v.x = (k2.x-k1.x)/dt;
+            v.y = (k2.y-k1.y)/dt;
+            v.z = (k2.z-k1.z)/dt;
+            break;
+        }
+    }
+    return v;
+}
+
+
 EnvironmentParser::EnvironmentParser(): nbElements(0)
 {
     // Create a root
@@ -39,31 +109,68 @@ EnvironmentParser::EnvironmentParser(): nbElements(0)
 EnvironmentParser::EnvironmentParser(const std::string &name): nbElements(0)
 {
     // Load the file
-    bool eResult = xmlDoc.LoadFile(name.c_str());
+    tinyxml2::XMLError eResult = xmlDoc.LoadFile(name.c_str());
     XMLCheckResult(eResult);
-    root = xmlDoc.FirstChildElement();
+    root = eResult == tinyxml2::XML_SUCCESS ? xmlDoc.FirstChildElement() : nullptr;
 }
 
 void EnvironmentParser::addCylinder(Epoint center1, Epoint center2, float radius)
+{
+    Ecylinder cylinder;
+    cylinder.x1 = center1.x;
+    cylinder.y1 = center1.y;
+    cylinder.z1 = center1.z;
+    cylinder.x2 = center2.x;
+    cylinder.y2 = center2.y;
+    cylinder.z2 = center2.z;
+    cylinder.radius = radius;
+    cylinder.vx = cylinder.vy = cylinder.vz = 0.f;
+    cylinder.id = nbElements+1;
+
+    addCylinder(cylinder);
+}
+
+void EnvironmentParser::addCylinder(const Ecylinder &cylinder)
 {
     // Create a new element "cylinder"
-    tinyxml2::XMLElement *cylinder = xmlDoc.NewElement("cylinder");
-    root->InsertEndChild(cylinder);
+    tinyxml2::XMLElement *pCylinder = xmlDoc.NewElement("cylinder");
+    root->InsertEndChild(pCylinder);
 
     // Save its characteristics
-    cylinder->SetAttribute("radius", radius);
+    pCylinder->SetAttribute("id", cylinder.id);
+    pCylinder->SetAttribute("radius", cylinder.radius);
 
     tinyxml2::XMLElement *point1 = xmlDoc.NewElement("center1");
-    point1->SetAttribute("x", center1.x);
-    point1->SetAttribute("y", center1.y);
-    point1->SetAttribute("z", center1.z);
-    cylinder->InsertEndChild(point1);
+    point1->SetAttribute("x", cylinder.x1);
+    point1->SetAttribute("y", cylinder.y1);
+    point1->SetAttribute("z", cylinder.z1);
+    pCylinder->InsertEndChild(point1);
 
     tinyxml2::XMLElement *point2 = xmlDoc.NewElement("center2");
-    point2->SetAttribute("x", center2.x);
-    point2->SetAttribute("y", center2.y);
-    point2->SetAttribute("z", center2.z);
-    cylinder->InsertEndChild(point2);
+    point2->SetAttribute("x", cylinder.x2);
+    point2->SetAttribute("y", cylinder.y2);
+    point2->SetAttribute("z", cylinder.z2);
+    pCylinder->InsertEndChild(point2);
+
+    // Save its motion, only for moving cylinders
+    if (cylinder.vx != 0.f || cylinder.vy != 0.f || cylinder.vz != 0.f)
+    {
+        tinyxml2::XMLElement *velocity = xmlDoc.NewElement("velocity");
+        velocity->SetAttribute("x", cylinder.vx);
+        velocity->SetAttribute("y", cylinder.vy);
+        velocity->SetAttribute("z", cylinder.vz);
+        pCylinder->InsertEndChild(velocity);
+    }
+
+    for (const Ekeyframe &k : cylinder.keyframes)
+    {
+        tinyxml2::XMLElement *keyframe = xmlDoc.NewElement("keyframe");
+        keyframe->SetAttribute("t", k.t);
+        keyframe->SetAttribute("x", k.x);
+        keyframe->SetAttribute("y", k.y);
+        keyframe->SetAttribute("z", k.z);
+        pCylinder->InsertEndChild(keyframe);
+    }
 
     nbElements++;
 }
@@ -77,18 +184,60 @@ void EnvironmentParser::save(std::string name)
     XMLCheckResult(eResult);
 }
 
+bool EnvironmentParser::write(const std::string &name, const std::vector<Ecylinder> &cylinders)
+{
+    FILE *file = fopen(name.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::cout << "Error: cannot open " << name << std::endl;
+        return false;
+    }
+
+    // large buffer, the file is written in a single pass
+    std::vector<char> buffer(1 << 20);
+    setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    // same layout as save(), with the 9 significant digits which give back the same floats when read
+    fprintf(file, "<root nbElements=\"%u\">\n", (unsigned int)cylinders.size());
+    for (const Ecylinder &c : cylinders)
+    {
+        fprintf(file, "    <cylinder id=\"%u\" radius=\"%.9g\">\n", c.id, c.radius);
+        fprintf(file, "        <center1 x=\"%.9g\" y=\"%.9g\" z=\"%.9g\"/>\n", c.x1, c.y1, c.z1);
+        fprintf(file, "        <center2 x=\"%.9g\" y=\"%.9g\" z=\"%.9g\"/>\n", c.x2, c.y2, c.z2);
+        if (c.vx != 0.f || c.vy != 0.f || c.vz != 0.f)
+            fprintf(file, "        <velocity x=\"%.9g\" y=\"%.9g\" z=\"%.9g\"/>\n", c.vx, c.vy, c.vz);
+        for (const Ekeyframe &k : c.keyframes)
+            fprintf(file, "        <keyframe t=\"%.9g\" x=\"%.9g\" y=\"%.9g\" z=\"%.9g\"/>\n", k.t, k.x, k.y, k.z);
+        fprintf(file, "    </cylinder>\n");
+    }
+    fprintf(file, "</root>\n");
+
+    bool success = ferror(file) == 0;
+    success = (fclose(file) == 0) && success;
+    if (!success)
+        std::cout << "Error: cannot write " << name << std::endl;
+    return success;
+}
+
 std::vector<Ecylinder> EnvironmentParser::readData()
 {
     int i(0);
     tinyxml2::XMLElement *element;
     std::vector<Ecylinder> cylinderList;
     Ecylinder cylinder;
+
+    if (root == nullptr)
+        return cylinderList;
+
     tinyxml2::XMLElement *pCylinder = root->FirstChildElement();
 
     root->QueryIntAttribute("nbElements", &nbElements);
 
-    for(i=0; i < nbElements; i++)
+    for(i=0; i < nbElements && pCylinder != nullptr; i++)
     {
+        // Files without ids number their cylinders in order
+        cylinder.id = i+1;
+        pCylinder->QueryUnsignedAttribute("id", &(cylinder.id));
         pCylinder->QueryFloatAttribute("radius", &(cylinder.radius));
 
         element = pCylinder->FirstChildElement("center1");
@@ -101,6 +250,27 @@ std::vector<Ecylinder> EnvironmentParser::readData()
         element->QueryFloatAttribute("y", &(cylinder.y2));
         element->QueryFloatAttribute("z", &(cylinder.z2));
 
+        // The motion is optional, cylinders are static by default
+        cylinder.vx = cylinder.vy = cylinder.vz = 0.f;
+        element = pCylinder->FirstChildElement("velocity");
+        if (element != nullptr)
+        {
+            element->QueryFloatAttribute("x", &(cylinder.vx));
+            element->QueryFloatAttribute("y", &(cylinder.vy));
+            element->QueryFloatAttribute("z", &(cylinder.vz));
+        }
+
+        cylinder.keyframes.clear();
+        for (element = pCylinder->FirstChildElement("keyframe"); element != nullptr; element = element->NextSiblingElement("keyframe"))
+        {
+            Ekeyframe keyframe = {0.f, 0.f, 0.f, 0.f};
+            element->QueryFloatAttribute("t", &(keyframe.t));
+            element->QueryFloatAttribute("x", &(keyframe.x));
+            element->QueryFloatAttribute("y", &(keyframe.y));
+            element->QueryFloatAttribute("z", &(keyframe.z));
+            cylinder.keyframes.push_back(keyframe);
+        }
+
         cylinderList.push_back(cylinder);
 
         pCylinder = pCylinder->NextSiblingElement();
@@ -109,7 +279,22 @@ std::vector<Ecylinder> EnvironmentParser::readData()
     return cylinderList;
 }
 
+std::shared_ptr<const Environment> EnvironmentParser::readEnvironment()
+{
+    EnvironmentPtr environment = Environment::create(readData());
+
+    // the cylinders now live in the environment, the document is not needed anymore
+    xmlDoc.Clear();
+    root = nullptr;
+    return environment;
+}
+
 int EnvironmentParser::getNbElements()
 {
     return nbElements;
 }
+
+bool EnvironmentParser::isLoaded()
+{
+    return root != nullptr;
+}
@@ -0,0 +1,162 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "environmentwatcher.h"
+#include <iostream>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+namespace
+{
+    // Period at which the background thread checks if it must stop, in milliseconds
+    const int POLL_TIMEOUT = 100;
+
+    bool sameCylinder(const Ecylinder &a, const Ecylinder &b)
+    {
+        if (a.x1 != b.x1 || a.y1 != b.y1 || a.z1 != b.z1 || a.x2 != b.x2 || a.y2 != b.y2 || a.z2 != b.z2
+                || a.radius != b.radius || a.vx != b.vx || a.vy != b.vy || a.vz != b.vz
+                || a.keyframes.size() != b.keyframes.size())
+            return false;
+
+        for (unsigned int i = 0; i < a.keyframes.size(); i++)
+        {
+            const Ekeyframe &ka = a.keyframes[i], &kb = b.keyframes[i];
+            if (ka.t != kb.t || ka.x != kb.x || ka.y != kb.y || ka.z != kb.z)
+                return false;
+        }
+        return true;
+    }
+}
+
+
+EnvironmentWatcher::EnvironmentWatcher(const std::string &filename, const EnvironmentPtr &environment):
+    applied(environment),
+    latest(environment),
+    hasPending(false),
+    running(true)
+{
+    // watch the directory rather than the file, editors often replace the file instead of writing it
+    size_t slash = filename.find_last_of('/');
+    directory = slash == std::string::npos ? "." : filename.substr(0, slash);
+    basename = slash == std::string::npos ? filename : filename.substr(slash+1);
+
+    inotifyFd = inotify_init1(IN_NONBLOCK);
+    if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cout << "Error: cannot watch " << filename << std::endl;
+        return;
+    }
+
+    thread = std::thread(&EnvironmentWatcher::run, this);
+}
+
+EnvironmentWatcher::~EnvironmentWatcher()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+}
+
+bool EnvironmentWatcher::pollDelta(EnvironmentDelta &delta)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!hasPending)
+        return false;
+
+    delta.added.swap(pending.added);
+    delta.removed.swap(pending.removed);
+    pending.added.clear();
+    pending.removed.clear();
+    applied = latest;
+    hasPending = false;
+    return true;
+}
+
+void EnvironmentWatcher::run()
+{
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd = {inotifyFd, POLLIN, 0};
+
+    while (running)
+    {
+        if (poll(&pfd, 1, POLL_TIMEOUT) <= 0)
+            continue;
+
+        // look for an event on the watched file among the events of the directory
+        bool modified = false;
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *ptr = buffer; ptr < buffer + length; )
+            {
+                const struct inotify_event *event = (const struct inotify_event *) ptr;
+                if (event->len > 0 && basename == event->name)
+                    modified = true;
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+
+        if (modified)
+            reload();
+    }
+}
+
+void EnvironmentWatcher::reload()
+{
+    // parse the file without holding the lock, the main loop may poll meanwhile
+    EnvironmentParser parser(directory + "/" + basename);
+    if (!parser.isLoaded())
+        return;
+
+    EnvironmentPtr environment = parser.readEnvironment();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    latest = environment;
+
+    // the changes are always computed against what the main loop has applied, both are sorted by id
+    pending.added.clear();
+    pending.removed.clear();
+    const std::vector<ObstaclePtr> &before = applied->getObstacles(), &after = latest->getObstacles();
+    auto old = before.begin(), cyl = after.begin();
+    while (old != before.end() || cyl != after.end())
+    {
+        if (cyl == after.end() || (old != before.end() && (*old)->cylinder.id < (*cyl)->cylinder.id))
+            pending.removed.push_back((*old++)->cylinder.id);
+        else if (old == before.end() || (*cyl)->cylinder.id < (*old)->cylinder.id)
+            pending.added.push_back(*cyl++);
+        else
+        {
+            if (!sameCylinder((*old)->cylinder, (*cyl)->cylinder))
+            {
+                pending.removed.push_back((*old)->cylinder.id);
+                pending.added.push_back(*cyl);
+            }
+            ++old;
+            ++cyl;
+        }
+    }
+    hasPending = !pending.added.empty() || !pending.removed.empty();
+}
@@ -0,0 +1,158 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+
+#include "eventtriggeredmpc.h"
+#include <algorithm>
+#include <cmath>
+
+USING_NAMESPACE_ACADO
+
+TriggerParameters::TriggerParameters():
+    positionTolerance(.05),
+    velocityTolerance(.1),
+    attitudeTolerance(.05),
+    rateTolerance(.2),
+    referenceTolerance(.05),
+    obstacleDistance(2.),
+    maxPlayback(.5)
+{
+}
+
+
+EventTriggeredMPC::EventTriggeredMPC(MPCSolver &mpc, const TriggerParameters &parameters):
+    mpc(mpc),
+    params(parameters),
+    lastTrigger(Trigger::NONE),
+    valid(false),
+    solveTime(0.),
+    interval(0.),
+    solvedReference({{0., 0., 0.}}),
+    u(MPCSolver::NB_CONTROLS)
+{
+    statistics.nbSteps = 0;
+    statistics.nbSolves = 0;
+    statistics.triggers.fill(0);
+    u.setZero();
+}
+
+bool EventTriggeredMPC::step(double t, const DVector &x)
+{
+    lastTrigger = check(t, x);
+    statistics.nbSteps++;
+    statistics.triggers[static_cast<unsigned int>(lastTrigger)]++;
+
+    if (lastTrigger == Trigger::NONE)
+    {
+        // play the control of the interval containing the current time
+        unsigned int k = std::min<unsigned int>(std::floor((t - solveTime)/interval), predictedControls.getNumPoints()-1);
+        for (unsigned int i = 0; i < MPCSolver::NB_CONTROLS; i++)
+            u(i) = predictedControls(k, i);
+        return true;
+    }
+
+    statistics.nbSolves++;
+    valid = mpc.step(t, x);
+    if (!valid)
+        return false;
+
+    mpc.getU(u);
+    mpc.getPrediction(predictedStates, predictedControls);
+    solveTime = t;
+    interval = mpc.getParameters().horizon/mpc.getParameters().nbIntervals;
+    const VariablesGrid &reference = mpc.getReference();
+    for (unsigned int i = 0; i < 3; i++)
+        solvedReference[i] = reference.getNumPoints() > 0 ? reference(0, i) : 0.;
+    return true;
+}
+
+Trigger EventTriggeredMPC::check(double t, const DVector &x)
+{
+    if (!valid)
+        return statistics.nbSolves == 0 ? Trigger::START : Trigger::FAILED;
+
+    if (t - solveTime >= params.maxPlayback || predictedStates.getNumPoints() < 2)
+        return Trigger::EXPIRED;
+
+    // the prediction is known at the nodes, interpolate it at the current time
+    double position = (t - solveTime)/interval;
+    unsigned int k = std::min<unsigned int>(std::floor(position), predictedStates.getNumPoints()-2);
+    double f = std::min(position - k, 1.);
+    auto predicted = [&](unsigned int i) { return (1.-f)*predictedStates(k, i) + f*predictedStates(k+1, i); };
+
+    double positionError = 0., velocityError = 0., attitudeError = 0., rateError = 0.;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        positionError += pow(x(i) - predicted(i), 2);
+        velocityError += pow(x(3+i) - predicted(3+i), 2);
+    }
+    unsigned int rates = mpc.getNbDroneStates() - 3;
+    for (unsigned int i = 6; i < rates; i++)
+        attitudeError = std::max(attitudeError, std::abs(x(i) - predicted(i)));
+    for (unsigned int i = rates; i < rates+3; i++)
+        rateError = std::max(rateError, std::abs(x(i) - predicted(i)));
+
+    if (sqrt(positionError) > params.positionTolerance || sqrt(velocityError) > params.velocityTolerance
+        || attitudeError > params.attitudeTolerance || rateError > params.rateTolerance)
+        return Trigger::DEVIATION;
+
+    const VariablesGrid &reference = mpc.getReference();
+    if (reference.getNumPoints() > 0)
+    {
+        double referenceChange = 0.;
+        for (unsigned int i = 0; i < 3; i++)
+            referenceChange += pow(reference(0, i) - solvedReference[i], 2);
+        if (sqrt(referenceChange) > params.referenceTolerance)
+            return Trigger::REFERENCE;
+    }
+
+    if (mpc.getObstacleDistance(t, x) < params.obstacleDistance)
+        return Trigger::OBSTACLE;
+
+    return Trigger::NONE;
+}
+
+void EventTriggeredMPC::getU(DVector &u) const
+{
+    u = this->u;
+}
+
+void EventTriggeredMPC::invalidate()
+{
+    valid = false;
+}
+
+Trigger EventTriggeredMPC::getLastTrigger() const
+{
+    return lastTrigger;
+}
+
+const TriggerStatistics &EventTriggeredMPC::getStatistics() const
+{
+    return statistics;
+}
+
+const TriggerParameters &EventTriggeredMPC::getParameters() const
+{
+    return params;
+}
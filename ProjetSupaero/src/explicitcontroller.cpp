@@ -0,0 +1,141 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "explicitcontroller.h"
+#include "dronemodel.h"
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    template <typename Matrix>
+    void writeMatrix(std::ofstream &file, const Matrix &matrix)
+    {
+        for (int i = 0; i < matrix.size(); i++)
+            file << matrix.data()[i] << (i+1 < matrix.size() ? " " : "\n");
+    }
+
+    template <typename Matrix>
+    void readMatrix(std::ifstream &file, Matrix &matrix)
+    {
+        for (int i = 0; i < matrix.size(); i++)
+            file >> matrix.data()[i];
+    }
+}
+
+
+ExplicitController::ExplicitController()
+{
+    network.W1.setZero();
+    network.b1.setZero();
+    network.W2.setZero();
+    network.b2.setZero();
+    network.W3.setZero();
+    network.b3.setZero();
+    network.inputMean.setZero();
+    network.inputScale.setOnes();
+    network.outputMean.setConstant(DroneModel::hoverSpeed());
+    network.outputScale.setOnes();
+}
+
+ExplicitController::ExplicitController(const Network &network):
+    network(network)
+{
+}
+
+bool ExplicitController::load(const std::string &filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        std::cout << "Error: cannot open " << filename << std::endl;
+        return false;
+    }
+
+    Network n;
+    readMatrix(file, n.W1);
+    readMatrix(file, n.b1);
+    readMatrix(file, n.W2);
+    readMatrix(file, n.b2);
+    readMatrix(file, n.W3);
+    readMatrix(file, n.b3);
+    readMatrix(file, n.inputMean);
+    readMatrix(file, n.inputScale);
+    readMatrix(file, n.outputMean);
+    readMatrix(file, n.outputScale);
+    if (!file)
+    {
+        std::cout << "Error: " << filename << " is not a valid network" << std::endl;
+        return false;
+    }
+
+    network = n;
+    return true;
+}
+
+bool ExplicitController::save(const std::string &filename) const
+{
+    std::ofstream file(filename);
+    file.precision(9);
+    writeMatrix(file, network.W1);
+    writeMatrix(file, network.b1);
+    writeMatrix(file, network.W2);
+    writeMatrix(file, network.b2);
+    writeMatrix(file, network.W3);
+    writeMatrix(file, network.b3);
+    writeMatrix(file, network.inputMean);
+    writeMatrix(file, network.inputScale);
+    writeMatrix(file, network.outputMean);
+    writeMatrix(file, network.outputScale);
+    return (bool)file;
+}
+
+Eigen::Matrix<float,ExplicitController::NB_INPUTS,1> ExplicitController::normalise(const std::array<double,12> &state,
+                                                                                    const std::array<double,3> &referenceVelocity) const
+{
+    // the position is not an input of the network
+    Eigen::Matrix<float,NB_INPUTS,1> input;
+    for (int i = 0; i < 9; i++)
+        input(i) = state[i+3];
+    for (int i = 0; i < 3; i++)
+        input(9+i) = referenceVelocity[i];
+    return (input - network.inputMean).cwiseQuotient(network.inputScale);
+}
+
+std::array<double,4> ExplicitController::evaluate(const std::array<double,12> &state, const std::array<double,3> &referenceVelocity) const
+{
+    Eigen::Matrix<float,NB_INPUTS,1> input = normalise(state, referenceVelocity);
+
+    // fixed size products, vectorised by Eigen
+    Eigen::Matrix<float,NB_HIDDEN,1> h1 = (network.W1*input + network.b1).array().tanh();
+    Eigen::Matrix<float,NB_HIDDEN,1> h2 = (network.W2*h1 + network.b2).array().tanh();
+    Eigen::Matrix<float,NB_OUTPUTS,1> output = network.W3*h2 + network.b3;
+    output = output.cwiseProduct(network.outputScale) + network.outputMean;
+
+    return {output(0), output(1), output(2), output(3)};
+}
+
+bool ExplicitController::inDomain(const std::array<double,12> &state, const std::array<double,3> &referenceVelocity) const
+{
+    return normalise(state, referenceVelocity).cwiseAbs().maxCoeff() <= DOMAIN_LIMIT;
+}
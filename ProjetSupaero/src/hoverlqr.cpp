@@ -0,0 +1,105 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include <cmath>
+#include <Eigen/LU>
+#include "hoverlqr.h"
+
+using namespace DroneModel;
+
+HoverLQR::HoverLQR(double period, const std::array<double,12> &stateWeights, const std::array<double,4> &commandWeights,
+                   unsigned int nbYawPoints)
+    : period(period), Q(StateMatrix::Zero()), R(Eigen::Matrix<double,4,4>::Zero())
+{
+    for (unsigned int i = 0; i < 12; i++)
+        Q(i,i) = stateWeights[i];
+    for (unsigned int i = 0; i < 4; i++)
+        R(i,i) = commandWeights[i];
+
+    gains.reserve(nbYawPoints);
+    for (unsigned int i = 0; i < nbYawPoints; i++)
+        gains.push_back(solve(-M_PI + 2.*M_PI*i/nbYawPoints));
+}
+
+std::array<double,12> HoverLQR::defaultStateWeights()
+{
+    return {{10., 10., 10., 1., 1., 1., 10., 10., 10., .1, .1, .1}};
+}
+
+DroneModel::Command HoverLQR::control(const State &x, const State &xRef, const Command &uRef) const
+{
+    State error = x - xRef;
+    // the yaw angle is compared on the circle
+    error(6) = std::remainder(error(6), 2.*M_PI);
+    return uRef - getGain(x(6))*error;
+}
+
+const HoverLQR::Gain &HoverLQR::getGain(double phi) const
+{
+    double position = (std::remainder(phi, 2.*M_PI) + M_PI) / (2.*M_PI) * gains.size();
+    unsigned int index = (unsigned int)std::lround(position) % gains.size();
+    return gains[index];
+}
+
+HoverLQR::Gain HoverLQR::solve(double phi) const
+{
+    State xTrim = State::Zero();
+    xTrim(6) = phi;
+    Command uTrim = Command::Constant(hoverSpeed());
+
+    StateMatrix A;
+    CommandMatrix B;
+    linearise(xTrim, uTrim, A, B);
+
+    // zero-order hold discretisation, with the series of the exponential
+    StateMatrix Ad = StateMatrix::Identity();
+    StateMatrix integral = StateMatrix::Identity() * period;
+    StateMatrix term = StateMatrix::Identity();
+    for (int k = 1; k < 10; k++)
+    {
+        term = term * A * period / k;
+        Ad += term;
+        integral += term * period / (k+1);
+    }
+    CommandMatrix Bd = integral * B;
+
+    // structure-preserving doubling: Hk converges to the solution of the discrete Riccati equation
+    StateMatrix Ak = Ad;
+    StateMatrix Gk = Bd * R.inverse() * Bd.transpose();
+    StateMatrix Hk = Q;
+    for (int k = 0; k < 100; k++)
+    {
+        StateMatrix W = (StateMatrix::Identity() + Gk*Hk).inverse();
+        StateMatrix AW = Ak*W;
+        StateMatrix Hnext = Hk + Ak.transpose()*Hk*W*Ak;
+        Gk = Gk + AW*Gk*Ak.transpose();
+        Ak = AW*Ak;
+        bool converged = (Hnext - Hk).norm() <= 1e-12 * Hnext.norm();
+        Hk = Hnext;
+        if (converged)
+            break;
+    }
+
+    Eigen::Matrix<double,4,4> S = R + Bd.transpose()*Hk*Bd;
+    return S.inverse() * Bd.transpose()*Hk*Ad;
+}
@@ -27,11 +27,15 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 
 
 Input::Input(bool joystickOn):
-	joystickOn_(joystickOn)
+	joystickOn_(joystickOn),
+	pauseKey_(false),
+	stepKey_(false)
 {
 }
 Input::Input():
-	joystickOn_(false)
+	joystickOn_(false),
+	pauseKey_(false),
+	stepKey_(false)
 {
 }
 
@@ -99,18 +103,19 @@ consigne[2] = -r*transSpeed/100;
     return consigne;
 }
 
+bool Input::pausePressed()
+{
+    // only the transition from released to pressed counts
+    bool pressed = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::P);
+    bool toggled = pressed && !pauseKey_;
+    pauseKey_ = pressed;
+    return toggled;
+}
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+bool Input::stepPressed()
+{
+    bool pressed = sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S);
+    bool toggled = pressed && !stepKey_;
+    stepKey_ = pressed;
+    return toggled;
+}
@@ -22,21 +22,656 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 
 
 #include "mpcsolver.h"
+#include "dronemodel.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
 
+USING_NAMESPACE_ACADO
 
-MPCSolver::MPCSolver()
+namespace
 {
-    // initialise everything here
+    // Layout of the online parameters, relative to the end of the drone state
+    const unsigned int HORIZON = 0;
+    const unsigned int WEIGHTS = HORIZON + 1;
+    const unsigned int U_MIN = WEIGHTS + MPCSolver::NB_OUTPUTS;
+    const unsigned int U_MAX = U_MIN + 1;
+    const unsigned int OBSTACLES = U_MAX + 1;
+
+    // Each obstacle slot holds a point of the axis, the unit vector of the axis, the radius including the margin
+    // and the velocity of the cylinder
+    const unsigned int SLOT_SIZE = 10;
+
+    // A corridor slot holds the unit normal of the half-space, its offset and the rate of the offset, from the velocity
+    // of the cylinder
+    const unsigned int CORRIDOR_SLOT_SIZE = 5;
+
+    // An empty slot holds a cylinder of null radius far away from the drone
+    const double EMPTY_SLOT_POSITION = 1e4;
+
+    // Slacks are penalised by (SLACK_WEIGHT*s + slackPenalty/(2*SLACK_WEIGHT))^2, of slope slackPenalty at s = 0
+    const double SLACK_WEIGHT = 1.;
+
+    // Gain pulling the norm of the quaternion back to 1, against the drift of the integration
+    const double QUATERNION_STABILISATION = 1.;
+
+    // Problem built for a structure, copied by the next solvers with the same structure
+    struct Prototype
+    {
+        MPCParameters parameters;
+        DifferentialEquation model;
+        std::shared_ptr<const RealTimeAlgorithm> algorithm;
+    };
+
+    std::mutex prototypesMutex;
+    std::unordered_map<size_t,Prototype> prototypes;
+
+    // Distance between the drone and the surface of a cylinder at a given time
+    float surfaceDistance(const Eobstacle &obstacle, double t, const DVector &x)
+    {
+        const Ecylinder &c = obstacle.cylinder;
+        const Epoint &a = obstacle.shape.axis;
+        Epoint o = c.displacement(t);
+        float dx = x(0)-c.x1-o.x, dy = x(1)-c.y1-o.y, dz = x(2)-c.z1-o.z;
+        float cx = dy*a.z-a.y*dz, cy = dz*a.x-a.z*dx, cz = dx*a.y-a.x*dy;
+        return sqrt(cx*cx+cy*cy+cz*cz) - c.radius;
+    }
+
+    template <typename T>
+    void hashCombine(size_t &seed, const T &value)
+    {
+        seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+    }
+}
+
+
+MPCParameters::MPCParameters():
+    nbIntervals(4),
+    nbObstacleSlots(6),
+    obstacleConstraints(ObstacleConstraints::CORRIDOR),
+    attitude(AttitudeModel::EULER_ANGLES),
+    actuatorDynamics(false),
+    vuMax(200.),
+    softConstraints(true),
+    slackPenalty(100.),
+    discretization(SINGLE_SHOOTING),
+    horizon(1.),
+    uMin(16.),
+    uMax(95.),
+    safetyMargin(1.)
+{
+    weights = {1e-1, 1e-1, 1e-1, 1e-9, 1e-9, 1e-9, 1e-9, 1e-1, 1e-1, 1e-1};
+}
+
+MPCParameters MPCParameters::longHorizon()
+{
+    MPCParameters parameters;
+    parameters.nbIntervals = 20;
+    parameters.horizon = 2.;
+    parameters.discretization = MULTIPLE_SHOOTING;
+    return parameters;
+}
+
+size_t MPCParameters::structureHash() const
+{
+    size_t seed = 0;
+    hashCombine(seed, nbIntervals);
+    hashCombine(seed, nbObstacleSlots);
+    hashCombine(seed, static_cast<int>(obstacleConstraints));
+    hashCombine(seed, static_cast<int>(attitude));
+    hashCombine(seed, actuatorDynamics);
+    hashCombine(seed, vuMax);
+    hashCombine(seed, softConstraints);
+    hashCombine(seed, discretization);
+    return seed;
+}
+
+bool MPCParameters::sameStructure(const MPCParameters &other) const
+{
+    return nbIntervals == other.nbIntervals && nbObstacleSlots == other.nbObstacleSlots
+        && obstacleConstraints == other.obstacleConstraints && attitude == other.attitude
+        && actuatorDynamics == other.actuatorDynamics && vuMax == other.vuMax
+        && softConstraints == other.softConstraints
+        && discretization == other.discretization;
+}
+
+MPCParameters MPCParameters::actuated()
+{
+    MPCParameters parameters;
+    parameters.actuatorDynamics = true;
+    return parameters;
+}
+
+
+MPCSolver::MPCSolver(const MPCParameters &parameters):
+    params(parameters),
+    nbDroneStates(parameters.attitude == AttitudeModel::QUATERNION ? NB_STATES_QUATERNION : NB_STATES),
+    nbStates(nbDroneStates + (parameters.actuatorDynamics ? NB_ACTUATOR_STATES : 0)),
+    slotSize(parameters.obstacleConstraints == ObstacleConstraints::CORRIDOR ? CORRIDOR_SLOT_SIZE : SLOT_SIZE),
+    nbSlacks(parameters.softConstraints ? (parameters.attitude == AttitudeModel::EULER_ANGLES ? 2 : 1) : 0),
+    nbOutputs(NB_OUTPUTS + nbSlacks),
+    hasPrediction(false)
+{
+    // the symbolic problem only depends on the structure, copy it when it has already been built
+    size_t hash = params.structureHash();
+    {
+        std::lock_guard<std::mutex> lock(prototypesMutex);
+        auto prototype = prototypes.find(hash);
+        if (prototype != prototypes.end() && prototype->second.parameters.sameStructure(params))
+        {
+            model = prototype->second.model;
+            alg.reset(new RealTimeAlgorithm(*prototype->second.algorithm));
+        }
+    }
+
+    if (!alg)
+    {
+        buildProblem();
+        std::lock_guard<std::mutex> lock(prototypesMutex);
+        if (prototypes.find(hash) == prototypes.end())
+            prototypes[hash] = Prototype{params, model, std::make_shared<RealTimeAlgorithm>(*alg)};
+    }
+
+    controller.reset(new Controller(*alg));
+
+    xAugmented.init(nbStates + OBSTACLES + slotSize*params.nbObstacleSlots);
+    xAugmented.setZero();
+    controls.init(NB_CONTROLS + nbSlacks);
+    controls.setZero();
+    slotCandidates.reserve(params.nbObstacleSlots);
 }
 
+void MPCSolver::clearPrototypes()
+{
+    std::lock_guard<std::mutex> lock(prototypesMutex);
+    prototypes.clear();
+}
+
+void MPCSolver::buildProblem()
+{
+    // ACADO numbers the variables globally, start from scratch for each solver
+    clearAllStaticCounters();
 
+    // INTRODUCE THE VARIABLES:
+    // -------------------------
+    DifferentialState x,y,z, vx,vy,vz;
+    std::vector<DifferentialState> attitude(nbDroneStates - 9);
+    DifferentialState p,q,r;
+    // x, y, z : position
+    // vx, vy, vz : linear velocity
+    // attitude : orientation, either phi, theta, psi (Yaw-Pitch-Roll = Euler(3,2,1)) or qw, qx, qy, qz
+    // p, q, r : angular velocity
+    std::vector<DifferentialState> propellers(nbStates - nbDroneStates);
+    Control c1,c2,c3,c4;
+    // c1, c2, c3, c4 : velocity of the propellers, or their acceleration when the velocities are the propellers states
+    std::vector<Control> slacks(nbSlacks);
+    // slacks : violation of the obstacle constraints, and of the attitude constraint with Euler angles
+    Expression u1 = c1, u2 = c2, u3 = c3, u4 = c4;
+    if (params.actuatorDynamics)
+    {
+        u1 = propellers[0];
+        u2 = propellers[1];
+        u3 = propellers[2];
+        u4 = propellers[3];
+    }
 
-//void MPCSolver::controlMPC(double t, double dt)
-//{
-    /* do a loop here:
-     * - send keyboard commands to alg
-     * - get the drone's last state vector X
-     * - compute the motor commands U for the next step (controller.step(t, X))
-     * - simulate the drone with that command for dt seconds (process.step(t,t+dt,U))
-     */
-//}
+    // Online parameters, declared after the drone states so that they come last in the augmented state
+    DifferentialState T;
+    // T : length of the horizon, the problem is written on a normalised time
+    std::vector<DifferentialState> w(NB_OUTPUTS);
+    // w : square root of the LSQ weights
+    DifferentialState uMin, uMax;
+    // uMin, uMax : bounds on the velocity of the propellers
+    std::vector<DifferentialState> o(slotSize*params.nbObstacleSlots);
+    // o : obstacle slots (point of the axis, unit vector of the axis, radius, velocity), or corridor slots (normal,
+    // offset, rate of the offset)
+
+    // Quad constants
+    using namespace DroneModel;
+
+    // DEFINE A DIFFERENTIAL EQUATION:
+    // -------------------------------
+    std::vector<Expression> states = {x, y, z, vx, vy, vz};
+    states.insert(states.end(), attitude.begin(), attitude.end());
+    states.insert(states.end(), {p, q, r});
+
+    std::vector<Expression> rhs = {vx, vy, vz};
+    if (params.attitude == AttitudeModel::QUATERNION)
+    {
+        DifferentialState &qw = attitude[0], &qx = attitude[1], &qy = attitude[2], &qz = attitude[3];
+        Expression normError = 1. - (qw*qw+qx*qx+qy*qy+qz*qz);
+        rhs.insert(rhs.end(), {
+            2.*Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*(qx*qz+qw*qy)/m,
+            2.*Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*(qy*qz-qw*qx)/m,
+            Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*(1.-2.*(qx*qx+qy*qy))/m - g,
+            .5*(-qx*p-qy*q-qz*r) + QUATERNION_STABILISATION*normError*qw,
+            .5*(qw*p+qy*r-qz*q) + QUATERNION_STABILISATION*normError*qx,
+            .5*(qw*q-qx*r+qz*p) + QUATERNION_STABILISATION*normError*qy,
+            .5*(qw*r+qx*q-qy*p) + QUATERNION_STABILISATION*normError*qz
+        });
+    }
+    else
+    {
+        DifferentialState &phi = attitude[0], &theta = attitude[1], &psi = attitude[2];
+        rhs.insert(rhs.end(), {
+            Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*sin(theta)/m,
+            -Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*sin(psi)*cos(theta)/m,
+            Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*cos(psi)*cos(theta)/m - g,
+            -cos(phi)*tan(theta)*p+sin(phi)*tan(theta)*q+r,
+            sin(phi)*p+cos(phi)*q,
+            cos(phi)/cos(theta)*p-sin(phi)/cos(theta)*q
+        });
+    }
+    rhs.insert(rhs.end(), {
+        (d*Cf*(u1*u1-u2*u2)+(Jy-Jz)*q*r)/Jx,
+        (d*Cf*(u4*u4-u3*u3)+(Jz-Jx)*p*r)/Jy,
+        (c*(u1*u1+u2*u2-u3*u3-u4*u4)+(Jx-Jy)*p*q)/Jz
+    });
+    if (params.actuatorDynamics)
+    {
+        states.insert(states.end(), propellers.begin(), propellers.end());
+        rhs.insert(rhs.end(), {c1, c2, c3, c4});
+    }
+
+    // The drone model, used by the simulated process, and the model of the problem, scaled by the horizon length
+    DifferentialEquation f;
+    for (unsigned int i = 0; i < nbStates; i++)
+    {
+        model << dot(states[i]) == rhs[i];
+        f << dot(states[i]) == T*rhs[i];
+    }
+
+    // The parameters are constant over the horizon, except the obstacles which move at their current velocity
+    f << dot(T) == 0.;
+    for (unsigned int i = 0; i < w.size(); i++)
+        f << dot(w[i]) == 0.;
+    f << dot(uMin) == 0.;
+    f << dot(uMax) == 0.;
+    for (unsigned int i = 0; i < o.size(); i++)
+    {
+        if (params.obstacleConstraints == ObstacleConstraints::CORRIDOR)
+        {
+            if (i%slotSize == 3)
+                f << dot(o[i]) == T*o[i+1];
+            else
+                f << dot(o[i]) == 0.;
+        }
+        else if (i%slotSize < 3)
+            f << dot(o[i]) == T*o[i+7];
+        else
+            f << dot(o[i]) == 0.;
+    }
+
+
+    // DEFINE LEAST SQUARE FUNCTION:
+    // -----------------------------
+    // The weights are applied to the function itself, and to the reference in step()
+    Function h;
+    h << w[0]*vx << w[1]*vy << w[2]*vz;
+    h << w[3]*u1 << w[4]*u2 << w[5]*u3 << w[6]*u4;
+    h << w[7]*p << w[8]*q << w[9]*r;
+    for (unsigned int i = 0; i < nbSlacks; i++)
+        h << SLACK_WEIGHT*slacks[i];
+
+    DMatrix Q(nbOutputs,nbOutputs);
+    Q.setIdentity();
+
+    DVector refVec(nbOutputs);
+    refVec.setZero(nbOutputs);
+
+
+    // DEFINE AN OPTIMAL CONTROL PROBLEM:
+    // ----------------------------------
+    OCP ocp(0., 1., params.nbIntervals);
+
+    ocp.minimizeLSQ(Q, h, refVec);
+
+    // Constraints on the velocity of each propeller
+    ocp.subjectTo(f);
+    ocp.subjectTo(0. <= u1 - uMin);
+    ocp.subjectTo(0. <= u2 - uMin);
+    ocp.subjectTo(0. <= u3 - uMin);
+    ocp.subjectTo(0. <= u4 - uMin);
+    ocp.subjectTo(u1 - uMax <= 0.);
+    ocp.subjectTo(u2 - uMax <= 0.);
+    ocp.subjectTo(u3 - uMax <= 0.);
+    ocp.subjectTo(u4 - uMax <= 0.);
+
+    // Rate limits of the propellers, their velocities are bounded by the constraints above
+    if (params.actuatorDynamics)
+    {
+        ocp.subjectTo(-params.vuMax <= c1 <= params.vuMax);
+        ocp.subjectTo(-params.vuMax <= c2 <= params.vuMax);
+        ocp.subjectTo(-params.vuMax <= c3 <= params.vuMax);
+        ocp.subjectTo(-params.vuMax <= c4 <= params.vuMax);
+    }
+
+    // Relaxation of the soft constraints
+    Expression obstacleSlack = 0., attitudeSlack = 0.;
+    if (params.softConstraints)
+    {
+        obstacleSlack = slacks[0];
+        if (params.attitude == AttitudeModel::EULER_ANGLES)
+            attitudeSlack = slacks[1];
+        for (unsigned int i = 0; i < nbSlacks; i++)
+            ocp.subjectTo(0. <= slacks[i]);
+    }
+
+    // Constraint to avoid singularity, the quaternion has none
+    if (params.attitude == AttitudeModel::EULER_ANGLES)
+    {
+        ocp.subjectTo(0. <= attitude[1] + 1. + attitudeSlack);
+        ocp.subjectTo(0. <= 1. - attitude[1] + attitudeSlack);
+    }
+
+    for (unsigned int i = 0; i < params.nbObstacleSlots; i++)
+    {
+        DifferentialState *s = &o[slotSize*i];
+        if (params.obstacleConstraints == ObstacleConstraints::CORRIDOR)
+        {
+            // Corridor: the position stays on the free side of the half-space
+            ocp.subjectTo(0. <= s[0]*x + s[1]*y + s[2]*z - s[3] + obstacleSlack);
+        }
+        else
+        {
+            // Cylindrical obstacles: squared distance to the axis greater than the squared radius
+            ocp.subjectTo(0. <= pow((y-s[1])*s[5]-s[4]*(z-s[2]),2)
+                              + pow((z-s[2])*s[3]-s[5]*(x-s[0]),2)
+                              + pow((x-s[0])*s[4]-s[3]*(y-s[1]),2)
+                              - pow(s[6],2) + obstacleSlack);
+        }
+    }
+
+
+    // SET UP THE MPC CONTROLLER:
+    // --------------------------
+    alg.reset(new RealTimeAlgorithm(ocp));
+    alg->set(INTEGRATOR_TYPE, INT_RK45);
+    alg->set(MAX_NUM_ITERATIONS,1);
+    alg->set(PRINT_COPYRIGHT, false);
+    // the online solver of ACADO always condenses the QP, its other QP options only apply to code generation
+    alg->set(DISCRETIZATION_TYPE, params.discretization);
+}
+
+const DifferentialEquation &MPCSolver::getModel() const
+{
+    return model;
+}
+
+unsigned int MPCSolver::getNbStates() const
+{
+    return nbStates;
+}
+
+unsigned int MPCSolver::getNbDroneStates() const
+{
+    return nbDroneStates;
+}
+
+const MPCParameters &MPCSolver::getParameters() const
+{
+    return params;
+}
+
+void MPCSolver::init(double t, const DVector &x)
+{
+    hasPrediction = false;
+    augmentState(t, x);
+    controller->init(t, xAugmented);
+}
+
+void MPCSolver::setHorizon(double horizon)
+{
+    params.horizon = horizon;
+}
+
+void MPCSolver::setWeights(const std::array<double,10> &weights)
+{
+    params.weights = weights;
+}
+
+void MPCSolver::setPropellerBounds(double uMin, double uMax)
+{
+    params.uMin = uMin;
+    params.uMax = uMax;
+}
+
+void MPCSolver::setSafetyMargin(double margin)
+{
+    params.safetyMargin = margin;
+}
+
+void MPCSolver::setSlackPenalty(double penalty)
+{
+    params.slackPenalty = penalty;
+}
+
+void MPCSolver::setObstacles(const Environment &environment)
+{
+    obstacles = environment.getObstacles();
+    slotCandidates.reserve(obstacles.size());
+}
+
+void MPCSolver::addObstacles(const std::vector<ObstaclePtr> &obstacles)
+{
+    this->obstacles.insert(this->obstacles.end(), obstacles.begin(), obstacles.end());
+    slotCandidates.reserve(this->obstacles.size());
+}
+
+void MPCSolver::removeObstacles(const std::vector<unsigned int> &ids)
+{
+    auto removed = [&ids](const ObstaclePtr &o) { return std::find(ids.begin(), ids.end(), o->cylinder.id) != ids.end(); };
+    obstacles.erase(std::remove_if(obstacles.begin(), obstacles.end(), removed), obstacles.end());
+}
+
+void MPCSolver::setReference(const VariablesGrid &reference)
+{
+    // the grids are only reallocated when the number of points changes, the loop of the simulation keeps it constant
+    if (reference.getNumPoints() != this->reference.getNumPoints() || reference.getNumValues() != this->reference.getNumValues()
+        || scaledReference.getNumPoints() != reference.getNumPoints())
+    {
+        this->reference = reference;
+        scaledReference.init(nbOutputs, reference);
+        return;
+    }
+    for (unsigned int i = 0; i < reference.getNumPoints(); i++)
+    {
+        this->reference.setTime(i, reference.getTime(i));
+        for (unsigned int j = 0; j < reference.getNumValues(); j++)
+            this->reference(i, j) = reference(i, j);
+    }
+}
+
+bool MPCSolver::step(double t, const DVector &x)
+{
+    augmentState(t, x);
+
+    // the weights are part of the LSQ function, so they have to be applied to the reference too
+    // the reference of the slacks gives the slope of their penalty
+    // scaledReference is sized by setReference, its values are written in place
+    for (unsigned int i = 0; i < reference.getNumPoints(); i++)
+    {
+        scaledReference.setTime(i, reference.getTime(i));
+        for (unsigned int j = 0; j < NB_OUTPUTS; j++)
+            scaledReference(i, j) = reference(i, j)*sqrt(params.weights[j]);
+        for (unsigned int j = NB_OUTPUTS; j < nbOutputs; j++)
+            scaledReference(i, j) = -params.slackPenalty/(2.*SLACK_WEIGHT);
+    }
+
+    bool success = controller->step(t, xAugmented, scaledReference) == SUCCESSFUL_RETURN;
+    if (success)
+        controller->getU(controls);
+    if (success && params.obstacleConstraints == ObstacleConstraints::CORRIDOR)
+        hasPrediction = alg->getDifferentialStates(prediction) == SUCCESSFUL_RETURN && prediction.getNumPoints() > 0;
+    return success;
+}
+
+void MPCSolver::getU(DVector &u)
+{
+    u.init(NB_CONTROLS);
+    for (unsigned int i = 0; i < NB_CONTROLS; i++)
+        u(i) = controls(i);
+}
+
+double MPCSolver::getObstacleSlack() const
+{
+    return nbSlacks > 0 ? std::max(controls(NB_CONTROLS), 0.) : 0.;
+}
+
+double MPCSolver::getAttitudeSlack() const
+{
+    return nbSlacks > 1 ? std::max(controls(NB_CONTROLS+1), 0.) : 0.;
+}
+
+void MPCSolver::getPrediction(VariablesGrid &states, VariablesGrid &controls) const
+{
+    alg->getDifferentialStates(states);
+    alg->getControls(controls);
+}
+
+const VariablesGrid &MPCSolver::getReference() const
+{
+    return reference;
+}
+
+float MPCSolver::getObstacleDistance(double t, const DVector &x) const
+{
+    float distance = std::numeric_limits<float>::infinity();
+    for (const ObstaclePtr &o : obstacles)
+        distance = std::min(distance, surfaceDistance(*o, t, x));
+    return distance;
+}
+
+void MPCSolver::augmentState(double t, const DVector &x)
+{
+    for (unsigned int i = 0; i < nbStates; i++)
+        xAugmented(i) = x(i);
+
+    xAugmented(nbStates+HORIZON) = params.horizon;
+    for (unsigned int i = 0; i < NB_OUTPUTS; i++)
+        xAugmented(nbStates+WEIGHTS+i) = sqrt(params.weights[i]);
+    xAugmented(nbStates+U_MIN) = params.uMin;
+    xAugmented(nbStates+U_MAX) = params.uMax;
+
+    fillObstacleSlots(t, x);
+}
+
+void MPCSolver::fillObstacleSlots(double t, const DVector &x)
+{
+    // rank the obstacles by distance between the drone and their surface at the current time
+    slotCandidates.clear();
+    for (unsigned int i = 0; i < obstacles.size(); i++)
+        slotCandidates.push_back(std::make_pair(surfaceDistance(*obstacles[i], t, x), i));
+
+    unsigned int nbFilled = std::min<unsigned int>(params.nbObstacleSlots, slotCandidates.size());
+    std::nth_element(slotCandidates.begin(), slotCandidates.begin() + nbFilled, slotCandidates.end());
+
+    for (unsigned int i = 0; i < params.nbObstacleSlots; i++)
+    {
+        unsigned int s = nbStates + OBSTACLES + slotSize*i;
+
+        if (params.obstacleConstraints == ObstacleConstraints::CORRIDOR)
+        {
+            if (i < nbFilled)
+                fillCorridorSlot(s, *obstacles[slotCandidates[i].second], t, x);
+            else
+            {
+                // an empty slot holds a half-space which contains everything
+                for (unsigned int j = 0; j < CORRIDOR_SLOT_SIZE; j++)
+                    xAugmented(s+j) = 0.;
+                xAugmented(s+3) = -1.;
+            }
+        }
+        else if (i < nbFilled)
+        {
+            const Ecylinder &c = obstacles[slotCandidates[i].second]->cylinder;
+            const Epoint &a = obstacles[slotCandidates[i].second]->shape.axis;
+            Epoint o = c.displacement(t);
+            Epoint v = c.velocity(t);
+
+            xAugmented(s)   = c.x1 + o.x;
+            xAugmented(s+1) = c.y1 + o.y;
+            xAugmented(s+2) = c.z1 + o.z;
+            xAugmented(s+3) = a.x;
+            xAugmented(s+4) = a.y;
+            xAugmented(s+5) = a.z;
+            xAugmented(s+6) = c.radius + params.safetyMargin;
+            xAugmented(s+7) = v.x;
+            xAugmented(s+8) = v.y;
+            xAugmented(s+9) = v.z;
+        }
+        else
+        {
+            xAugmented(s)   = EMPTY_SLOT_POSITION;
+            xAugmented(s+1) = EMPTY_SLOT_POSITION;
+            xAugmented(s+2) = EMPTY_SLOT_POSITION;
+            xAugmented(s+3) = 0.;
+            xAugmented(s+4) = 0.;
+            xAugmented(s+5) = 1.;
+            xAugmented(s+6) = 0.;
+            xAugmented(s+7) = 0.;
+            xAugmented(s+8) = 0.;
+            xAugmented(s+9) = 0.;
+        }
+    }
+}
+
+void MPCSolver::fillCorridorSlot(unsigned int s, const Eobstacle &obstacle, double t, const DVector &x)
+{
+    const Ecylinder &c = obstacle.cylinder;
+    Epoint o = c.displacement(t);
+    Epoint v = c.velocity(t);
+    double px = c.x1 + o.x, py = c.y1 + o.y, pz = c.z1 + o.z;
+    double ax = obstacle.shape.axis.x, ay = obstacle.shape.axis.y, az = obstacle.shape.axis.z;
+
+    // unit vector from the axis to a point, perpendicular to the axis, and the distance between them
+    auto normalTo = [&](double qx, double qy, double qz, double n[3]) -> double
+    {
+        double dx = qx-px, dy = qy-py, dz = qz-pz;
+        double along = dx*ax + dy*ay + dz*az;
+        n[0] = dx - along*ax; n[1] = dy - along*ay; n[2] = dz - along*az;
+        double distance = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (distance > 1e-9)
+            for (int j = 0; j < 3; j++)
+                n[j] /= distance;
+        return distance;
+    };
+
+    // the half-space faces the point of the predicted trajectory closest to the axis
+    double radius = c.radius + params.safetyMargin;
+    double n[3], candidate[3];
+    double closest = normalTo(x(0), x(1), x(2), n);
+    double current[3] = {n[0], n[1], n[2]};
+    if (hasPrediction)
+    {
+        for (unsigned int k = 0; k < prediction.getNumPoints(); k++)
+        {
+            double distance = normalTo(prediction(k, 0), prediction(k, 1), prediction(k, 2), candidate);
+            if (distance < closest && distance > 1e-9)
+            {
+                closest = distance;
+                std::copy(candidate, candidate+3, n);
+            }
+        }
+    }
+
+    // the drone must be on the free side, otherwise the half-space faces the drone itself
+    if ((x(0)-px)*n[0] + (x(1)-py)*n[1] + (x(2)-pz)*n[2] < radius)
+        std::copy(current, current+3, n);
+
+    // on the axis, any direction perpendicular to it
+    if (n[0]*n[0] + n[1]*n[1] + n[2]*n[2] < .5)
+    {
+        double ux = std::abs(ax) < .9 ? 1. : 0., uy = 1.-ux;
+        normalTo(px + uy*az, py - ux*az, pz + ux*ay - uy*ax, n);
+    }
+
+    xAugmented(s)   = n[0];
+    xAugmented(s+1) = n[1];
+    xAugmented(s+2) = n[2];
+    xAugmented(s+3) = n[0]*px + n[1]*py + n[2]*pz + radius;
+    xAugmented(s+4) = n[0]*v.x + n[1]*v.y + n[2]*v.z;
+}
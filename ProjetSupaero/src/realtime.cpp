@@ -0,0 +1,138 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "realtime.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <alloca.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace
+{
+    void reportError(const char *step)
+    {
+        std::cout << "Error: cannot " << step << ": " << std::strerror(errno) << std::endl;
+    }
+
+    // touch the stack below the current frame, its pages stay resident once the memory is locked
+    void prefaultStack(size_t size)
+    {
+        volatile char *stack = static_cast<volatile char *>(alloca(size));
+        for (size_t i = 0; i < size; i += 4096)
+            stack[i] = 0;
+    }
+
+    // move the other threads of the process to the cores they may use, but the given one: they are not scheduled
+    // with the real-time policy, and could starve behind the control loop on its core
+    bool moveOtherThreads(int cpu)
+    {
+        cpu_set_t cpus;
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0)
+            return false;
+        CPU_CLR(cpu, &cpus);
+        if (CPU_COUNT(&cpus) == 0)
+        {
+            errno = EINVAL;
+            return false;
+        }
+
+        DIR *tasks = opendir("/proc/self/task");
+        if (tasks == nullptr)
+            return false;
+        bool success = true;
+        pid_t self = syscall(SYS_gettid);
+        while (dirent *task = readdir(tasks))
+        {
+            pid_t tid = std::atoi(task->d_name);
+            if (tid > 0 && tid != self && sched_setaffinity(tid, sizeof(cpus), &cpus) != 0)
+                success = false;
+        }
+        closedir(tasks);
+        return success;
+    }
+}
+
+
+RealTimeProfile::RealTimeProfile():
+    cpu(-1),
+    priority(80),
+    lockMemory(true),
+    stackPrefault(512*1024)
+{
+}
+
+bool RealTime::apply(const RealTimeProfile &profile)
+{
+    bool success = true;
+
+    if (profile.cpu >= 0)
+    {
+        if (!moveOtherThreads(profile.cpu))
+        {
+            reportError("move the other threads away from the core");
+            success = false;
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(profile.cpu, &cpus);
+        errno = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (errno != 0)
+        {
+            reportError("pin the thread to its core");
+            success = false;
+        }
+    }
+
+    if (profile.priority > 0)
+    {
+        sched_param param = {};
+        param.sched_priority = profile.priority;
+        errno = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (errno != 0)
+        {
+            reportError("set the real-time priority");
+            success = false;
+        }
+    }
+
+    if (profile.lockMemory)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            reportError("lock the memory");
+            success = false;
+        }
+        else
+            prefaultStack(profile.stackPrefault);
+    }
+
+    return success;
+}
@@ -0,0 +1,147 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "referencegenerator.h"
+#include "dronemodel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Time step of the filter, larger steps are split
+    const double FILTER_STEP = 0.01;
+}
+
+
+ReferenceGenerator::ReferenceGenerator(int nbIntervals, double horizon, double maxAcceleration, double maxJerk):
+    nbIntervals(nbIntervals),
+    horizon(horizon),
+    maxAcceleration(maxAcceleration),
+    maxJerk(maxJerk),
+    velocity({0., 0., 0.}),
+    acceleration({0., 0., 0.}),
+    currentWaypoint(0),
+    preview(nbIntervals+1)
+{
+    for (unsigned int i = 0; i < preview.size(); i++)
+        writePoint(i, velocity);
+}
+
+void ReferenceGenerator::setHorizon(double horizon)
+{
+    this->horizon = horizon;
+}
+
+void ReferenceGenerator::update(double dt, const Vector &command)
+{
+    // advance the current state of the filter
+    for (double remaining = dt; remaining > 0.; remaining -= FILTER_STEP)
+        advance(velocity, acceleration, command, std::min(remaining, FILTER_STEP));
+
+    // preview, the command being kept constant
+    Vector v = velocity, a = acceleration;
+    double step = horizon/nbIntervals;
+    writePoint(0, v);
+    for (int i = 1; i <= nbIntervals; i++)
+    {
+        for (double remaining = step; remaining > 0.; remaining -= FILTER_STEP)
+            advance(v, a, command, std::min(remaining, FILTER_STEP));
+        writePoint(i, v);
+    }
+}
+
+void ReferenceGenerator::update(double dt, const Vector &position, const std::vector<Vector> &waypoints, double speed, double acceptance)
+{
+    // target velocity towards a waypoint, null once the last one is reached
+    auto target = [&](const Vector &p, unsigned int &w)
+    {
+        Vector direction = {0., 0., 0.};
+        while (w < waypoints.size())
+        {
+            for (int k = 0; k < 3; k++)
+                direction[k] = waypoints[w][k] - p[k];
+            double distance = sqrt(direction[0]*direction[0] + direction[1]*direction[1] + direction[2]*direction[2]);
+            if (distance > acceptance)
+            {
+                for (int k = 0; k < 3; k++)
+                    direction[k] *= std::min(speed, distance)/distance;
+                return direction;
+            }
+            w++;
+        }
+        return Vector{0., 0., 0.};
+    };
+
+    Vector command = target(position, currentWaypoint);
+    for (double remaining = dt; remaining > 0.; remaining -= FILTER_STEP)
+        advance(velocity, acceleration, command, std::min(remaining, FILTER_STEP));
+
+    // preview, the position being predicted from the reference itself
+    Vector p = position, v = velocity, a = acceleration;
+    unsigned int w = currentWaypoint;
+    double step = horizon/nbIntervals;
+    writePoint(0, v);
+    for (int i = 1; i <= nbIntervals; i++)
+    {
+        for (double remaining = step; remaining > 0.; remaining -= FILTER_STEP)
+        {
+            double h = std::min(remaining, FILTER_STEP);
+            advance(v, a, target(p, w), h);
+            for (int k = 0; k < 3; k++)
+                p[k] += v[k]*h;
+        }
+        writePoint(i, v);
+    }
+}
+
+unsigned int ReferenceGenerator::getNbPoints() const
+{
+    return preview.size();
+}
+
+const ReferenceGenerator::Point &ReferenceGenerator::getPoint(unsigned int i) const
+{
+    return preview[i];
+}
+
+void ReferenceGenerator::advance(Vector &velocity, Vector &acceleration, const Vector &target, double dt) const
+{
+    for (int k = 0; k < 3; k++)
+    {
+        // acceleration from which the target can be reached by braking at the maximal jerk
+        double error = target[k] - velocity[k];
+        double desired = std::min(maxAcceleration, sqrt(2.*maxJerk*fabs(error)));
+        desired = error >= 0. ? desired : -desired;
+
+        double jerk = std::max(-maxJerk, std::min(maxJerk, (desired - acceleration[k])/dt));
+        acceleration[k] += jerk*dt;
+        velocity[k] += acceleration[k]*dt;
+    }
+}
+
+void ReferenceGenerator::writePoint(unsigned int i, const Vector &velocity)
+{
+    // propellers at hover velocity, and no rotation
+    double hover = DroneModel::hoverSpeed();
+    preview[i] = {velocity[0], velocity[1], velocity[2], hover, hover, hover, hover, 0., 0., 0.};
+}
@@ -0,0 +1,107 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "sensormodel.h"
+
+using namespace DroneModel;
+
+SensorParameters::SensorParameters():
+    imuRate(200.),
+    poseRate(20.),
+    accelerometerNoise(.1),
+    gyroscopeNoise(.01),
+    positionNoise(.02),
+    orientationNoise(.01),
+    seed(0)
+{
+}
+
+
+SensorModel::SensorModel(const SensorParameters &parameters):
+    params(parameters),
+    rng(parameters.seed),
+    noise(0., 1.),
+    nbImuSamples(0),
+    nbPoseSamples(0)
+{
+}
+
+void SensorModel::update(double t0, const State &x0, double t1, const State &x1, const Command &u, SensorSamples &samples)
+{
+    samples.clear();
+    if (t1 <= t0)
+        return;
+
+    // the body frame only sees the thrust, the model has no drag
+    double thrust = Cf*u.squaredNorm()/m;
+
+    while (true)
+    {
+        double tImu = (nbImuSamples+1)/params.imuRate;
+        double tPose = (nbPoseSamples+1)/params.poseRate;
+        double t = std::min(tImu, tPose);
+        if (t > t1)
+            break;
+
+        // the samples older than t0 are skipped, e.g. when the sensors start after the simulation
+        State x = x0 + (x1 - x0)*std::max(0., (t - t0)/(t1 - t0));
+        SensorSample sample;
+        sample.t = t;
+
+        if (tImu <= tPose)
+        {
+            nbImuSamples++;
+            sample.type = SensorSample::IMU;
+            sample.acceleration = Eigen::Vector3d(0., 0., thrust);
+            sample.angularVelocity = x.tail<3>();
+            for (int i = 0; i < 3; i++)
+            {
+                sample.acceleration(i) += params.accelerometerNoise*noise(rng);
+                sample.angularVelocity(i) += params.gyroscopeNoise*noise(rng);
+            }
+        }
+        else
+        {
+            nbPoseSamples++;
+            sample.type = SensorSample::POSE;
+            sample.position = x.head<3>();
+            Eigen::Vector3d rotation;
+            for (int i = 0; i < 3; i++)
+            {
+                sample.position(i) += params.positionNoise*noise(rng);
+                rotation(i) = params.orientationNoise*noise(rng);
+            }
+            Eigen::Quaterniond q = attitude(x(6), x(7), x(8))
+                    * Eigen::Quaterniond(1., rotation(0)/2., rotation(1)/2., rotation(2)/2.).normalized();
+            sample.orientation = Eigen::Vector4d(q.w(), q.x(), q.y(), q.z());
+        }
+
+        if (t > t0)
+            samples.push_back(sample);
+    }
+}
+
+const SensorParameters &SensorModel::getParameters() const
+{
+    return params;
+}
@@ -0,0 +1,269 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "sharedstate.h"
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+    const uint32_t MAGIC = 0x50534d34;     // "PSM4"
+    const int MAX_RETRIES = 1000;           // Attempts to read a slot before giving up, e.g. if the publisher died in it
+
+    // Layout of the shared memory: a header followed by the slots. The atomics are lock-free, so they can be shared
+    // between processes.
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t nbSlots;
+        uint32_t recordSize;
+        std::atomic<uint64_t> nbPublished;  // Number of records published, the last one is at nbPublished-1
+    };
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;     // Odd while the record is written
+        SharedStateRecord record;
+    };
+
+    Slot *slots(void *memory)
+    {
+        return reinterpret_cast<Slot*>(static_cast<char*>(memory) + sizeof(Header));
+    }
+
+    const Slot *slots(const void *memory)
+    {
+        return reinterpret_cast<const Slot*>(static_cast<const char*>(memory) + sizeof(Header));
+    }
+}
+
+
+SharedStatePublisher::SharedStatePublisher(const std::string &name, unsigned int nbSlots):
+    name(name),
+    size(sizeof(Header) + nbSlots*sizeof(Slot)),
+    memory(nullptr),
+    nbPublished(0)
+{
+    if (nbSlots == 0)
+    {
+        std::cout << "Error: the shared memory " << name << " needs at least one slot" << std::endl;
+        return;
+    }
+
+    // a new object replaces the previous one, the readers still mapping the previous one are not affected
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0)
+    {
+        std::cout << "Error: cannot create the shared memory " << name << std::endl;
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cout << "Error: cannot map the shared memory " << name << std::endl;
+        return;
+    }
+    memory = mapping;
+
+    // a new object is filled with zeros, every slot starts with an even sequence; the magic number is written last
+    Header *header = static_cast<Header*>(memory);
+    header->nbSlots = nbSlots;
+    header->recordSize = sizeof(SharedStateRecord);
+    header->nbPublished.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = MAGIC;
+}
+
+SharedStatePublisher::~SharedStatePublisher()
+{
+    if (!memory)
+        return;
+    munmap(memory, size);
+    shm_unlink(name.c_str());
+}
+
+bool SharedStatePublisher::isOpen() const
+{
+    return memory != nullptr;
+}
+
+void SharedStatePublisher::publish(SharedStateRecord &record)
+{
+    record.index = nbPublished;
+    if (!memory)
+    {
+        nbPublished++;
+        return;
+    }
+
+    Header *header = static_cast<Header*>(memory);
+    Slot &slot = slots(memory)[nbPublished % header->nbSlots];
+
+    // sequence lock: odd sequence while writing, the readers check it did not change during their copy
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.record, &record, sizeof(record));
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+
+    nbPublished++;
+    header->nbPublished.store(nbPublished, std::memory_order_release);
+}
+
+
+SharedStateReader::SharedStateReader(const std::string &name):
+    size(0),
+    memory(nullptr),
+    nextIndex(0),
+    nbLost(0)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return;
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(Header))
+    {
+        close(fd);
+        return;
+    }
+
+    void *mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return;
+
+    const Header *header = static_cast<const Header*>(mapping);
+    if (header->magic != MAGIC || header->recordSize != sizeof(SharedStateRecord) || header->nbSlots == 0
+            || (size_t)status.st_size < sizeof(Header) + header->nbSlots*sizeof(Slot))
+    {
+        munmap(mapping, status.st_size);
+        return;
+    }
+
+    memory = mapping;
+    size = status.st_size;
+    nextIndex = header->nbPublished.load(std::memory_order_acquire);
+}
+
+SharedStateReader::~SharedStateReader()
+{
+    if (memory)
+        munmap(const_cast<void*>(memory), size);
+}
+
+bool SharedStateReader::isOpen() const
+{
+    return memory != nullptr;
+}
+
+bool SharedStateReader::latest(SharedStateRecord &record)
+{
+    if (!memory)
+        return false;
+
+    // the last record can be overwritten while it is read, then the new last one is read; if nothing was published
+    // meanwhile, the slot is held by a publisher which stopped writing it
+    const Header *header = static_cast<const Header*>(memory);
+    uint64_t nbPublished = header->nbPublished.load(std::memory_order_acquire);
+    while (nbPublished > 0)
+    {
+        if (read(nbPublished - 1, record))
+            return true;
+        uint64_t previous = nbPublished;
+        nbPublished = header->nbPublished.load(std::memory_order_acquire);
+        if (nbPublished == previous)
+            return false;
+    }
+    return false;
+}
+
+bool SharedStateReader::next(SharedStateRecord &record)
+{
+    if (!memory)
+        return false;
+
+    const Header *header = static_cast<const Header*>(memory);
+    while (true)
+    {
+        uint64_t nbPublished = header->nbPublished.load(std::memory_order_acquire);
+        if (nextIndex >= nbPublished)
+            return false;
+
+        // skip the records already overwritten
+        if (nbPublished - nextIndex > header->nbSlots)
+        {
+            nbLost += nbPublished - header->nbSlots - nextIndex;
+            nextIndex = nbPublished - header->nbSlots;
+        }
+
+        if (read(nextIndex, record))
+        {
+            nextIndex++;
+            return true;
+        }
+        if (header->nbPublished.load(std::memory_order_acquire) == nbPublished)
+            return false;
+    }
+}
+
+uint64_t SharedStateReader::getNbLost() const
+{
+    return nbLost;
+}
+
+bool SharedStateReader::read(uint64_t index, SharedStateRecord &record)
+{
+    const Header *header = static_cast<const Header*>(memory);
+    const Slot &slot = slots(memory)[index % header->nbSlots];
+
+    for (int retry = 0; retry < MAX_RETRIES; retry++)
+    {
+        if (retry > 0)
+            std::this_thread::yield();
+
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+        std::memcpy(&record, &slot.record, sizeof(record));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+        if (before != after)
+            continue;
+
+        // the slot may already hold a newer record
+        return record.index == index;
+    }
+    return false;
+}
@@ -0,0 +1,97 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+
+#include "simulationclock.h"
+
+SimulationClock::SimulationClock(ClockMode mode, double step, double scale)
+    : mode(mode), step(step), scale(scale), t(0.), nbSteps(0), lastTick(Wall::now()), paused(false), stepRequested(false)
+{
+}
+
+double SimulationClock::tick()
+{
+    Wall::time_point now = Wall::now();
+    double elapsed = std::chrono::duration<double>(now - lastTick).count();
+    lastTick = now;
+
+    if (paused && !stepRequested)
+        return 0.;
+
+    double previous = t;
+    if (paused || mode == ClockMode::LOCKSTEP)
+    {
+        // the time is a multiple of the step, so that it does not depend on the rounding of a sum
+        nbSteps++;
+        t = mode == ClockMode::LOCKSTEP ? nbSteps*step : t + step;
+        stepRequested = false;
+    }
+    else if (mode == ClockMode::SCALED)
+        t += elapsed*scale;
+    else
+        t += elapsed;
+    return t - previous;
+}
+
+double SimulationClock::getTime() const
+{
+    return t;
+}
+
+void SimulationClock::setPaused(bool paused)
+{
+    if (this->paused && !paused)
+        lastTick = Wall::now();
+    this->paused = paused;
+    stepRequested = false;
+}
+
+void SimulationClock::stepOnce()
+{
+    stepRequested = true;
+}
+
+bool SimulationClock::isRunning() const
+{
+    return !paused || stepRequested;
+}
+
+bool SimulationClock::isPaused() const
+{
+    return paused;
+}
+
+ClockMode SimulationClock::getMode() const
+{
+    return mode;
+}
+
+double SimulationClock::getStep() const
+{
+    return step;
+}
+
+double SimulationClock::getScale() const
+{
+    return scale;
+}
@@ -0,0 +1,282 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include "stateestimator.h"
+#include <chrono>
+#include <Eigen/Cholesky>
+
+using namespace DroneModel;
+
+namespace
+{
+    Eigen::Matrix3d skew(const Eigen::Vector3d &v)
+    {
+        Eigen::Matrix3d m;
+        m <<    0., -v(2),  v(1),
+              v(2),    0., -v(0),
+             -v(1),  v(0),    0.;
+        return m;
+    }
+
+    // Quaternion of a small rotation
+    Eigen::Quaterniond rotation(const Eigen::Vector3d &angle)
+    {
+        return Eigen::Quaterniond(1., angle(0)/2., angle(1)/2., angle(2)/2.).normalized();
+    }
+
+    // Initial standard deviations of the errors of position, velocity and orientation
+    const double INITIAL_POSITION = .01, INITIAL_VELOCITY = .01, INITIAL_ORIENTATION = .01;
+}
+
+
+Ekf::Ekf(const SensorParameters &parameters):
+    params(parameters)
+{
+    init(0., State::Zero());
+}
+
+void Ekf::init(double t, const State &x)
+{
+    this->t = t;
+    position = x.head<3>();
+    velocity = x.segment<3>(3);
+    orientation = attitude(x(6), x(7), x(8));
+    angularVelocity = x.tail<3>();
+
+    P.setZero();
+    P.block<3,3>(0,0).diagonal().setConstant(INITIAL_POSITION*INITIAL_POSITION);
+    P.block<3,3>(3,3).diagonal().setConstant(INITIAL_VELOCITY*INITIAL_VELOCITY);
+    P.block<3,3>(6,6).diagonal().setConstant(INITIAL_ORIENTATION*INITIAL_ORIENTATION);
+}
+
+void Ekf::predict(const SensorSample &sample)
+{
+    double dt = sample.t - t;
+    t = sample.t;
+    angularVelocity = sample.angularVelocity;
+    if (dt <= 0.)
+        return;
+
+    // nominal state
+    Eigen::Matrix3d R = orientation.toRotationMatrix();
+    Eigen::Vector3d acceleration = R*sample.acceleration - Eigen::Vector3d(0., 0., g);
+    position += velocity*dt + acceleration*dt*dt/2.;
+    velocity += acceleration*dt;
+    orientation = (orientation*rotation(sample.angularVelocity*dt)).normalized();
+
+    // covariance of the error
+    Covariance F = Covariance::Identity();
+    F.block<3,3>(0,3).diagonal().setConstant(dt);
+    F.block<3,3>(3,6) = -R*skew(sample.acceleration)*dt;
+    F.block<3,3>(6,6) -= skew(sample.angularVelocity)*dt;
+
+    P = F*P*F.transpose();
+    P.block<3,3>(3,3).diagonal().array() += params.accelerometerNoise*params.accelerometerNoise*dt;
+    P.block<3,3>(6,6).diagonal().array() += params.gyroscopeNoise*params.gyroscopeNoise*dt;
+}
+
+void Ekf::correct(const SensorSample &sample)
+{
+    // residual of the position, and rotation from the estimate to the measured orientation
+    Eigen::Quaterniond measured(sample.orientation(0), sample.orientation(1), sample.orientation(2), sample.orientation(3));
+    Eigen::Quaterniond difference = orientation.conjugate()*measured;
+    if (difference.w() < 0.)
+        difference.coeffs() = -difference.coeffs();
+
+    Eigen::Matrix<double,6,1> residual;
+    residual.head<3>() = sample.position - position;
+    residual.tail<3>() = 2.*difference.vec();
+
+    // the measurement is the position and the orientation error, H selects them
+    Eigen::Matrix<double,6,9> H = Eigen::Matrix<double,6,9>::Zero();
+    H.block<3,3>(0,0).setIdentity();
+    H.block<3,3>(3,6).setIdentity();
+    Eigen::Matrix<double,6,6> noise = Eigen::Matrix<double,6,6>::Zero();
+    noise.block<3,3>(0,0).diagonal().setConstant(params.positionNoise*params.positionNoise);
+    noise.block<3,3>(3,3).diagonal().setConstant(params.orientationNoise*params.orientationNoise);
+
+    Eigen::Matrix<double,6,6> S = H*P*H.transpose() + noise;
+    Eigen::Matrix<double,9,6> K = S.ldlt().solve(H*P).transpose();
+    Eigen::Matrix<double,9,1> error = K*residual;
+
+    position += error.head<3>();
+    velocity += error.segment<3>(3);
+    orientation = (orientation*rotation(error.tail<3>())).normalized();
+
+    // Joseph form, which keeps P symmetric positive
+    Covariance A = Covariance::Identity() - K*H;
+    P = A*P*A.transpose() + K*noise*K.transpose();
+}
+
+State Ekf::getState() const
+{
+    State x;
+    x.head<3>() = position;
+    x.segment<3>(3) = velocity;
+    x.segment<3>(6) = eulerAngles(orientation);
+    x.tail<3>() = angularVelocity;
+    return x;
+}
+
+double Ekf::getTime() const
+{
+    return t;
+}
+
+const Ekf::Covariance &Ekf::getCovariance() const
+{
+    return P;
+}
+
+
+StateEstimator::StateEstimator(const SensorParameters &parameters):
+    ekf(parameters),
+    queueBegin(0),
+    queueEnd(0),
+    estimate(State::Zero()),
+    estimateTime(0.),
+    reset(false),
+    processing(false),
+    resetTime(0.),
+    resetState(State::Zero()),
+    running(true),
+    nbUpdates(0),
+    nbDropped(0),
+    updateTime(0.)
+{
+    thread = std::thread(&StateEstimator::run, this);
+}
+
+StateEstimator::~StateEstimator()
+{
+    running = false;
+    condition.notify_one();
+    idle.notify_all();
+    thread.join();
+}
+
+void StateEstimator::init(double t, const State &x)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    queueBegin = queueEnd;
+    reset = true;
+    resetTime = t;
+    resetState = x;
+    estimate = x;
+    estimateTime = t;
+    condition.notify_one();
+}
+
+void StateEstimator::push(const SensorSamples &samples)
+{
+    if (samples.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const SensorSample &sample : samples)
+        {
+            // drop the oldest sample when the queue is full
+            if (queueEnd - queueBegin == QUEUE_SIZE)
+            {
+                queueBegin++;
+                nbDropped++;
+            }
+            queue[queueEnd % QUEUE_SIZE] = sample;
+            queueEnd++;
+        }
+    }
+    condition.notify_one();
+}
+
+void StateEstimator::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return !running || (!reset && !processing && queueBegin == queueEnd); });
+}
+
+double StateEstimator::getEstimate(State &x)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    x = estimate;
+    return estimateTime;
+}
+
+double StateEstimator::getMeanUpdateTime() const
+{
+    unsigned long n = nbUpdates;
+    return n > 0 ? updateTime/n : 0.;
+}
+
+unsigned long StateEstimator::getNbUpdates() const
+{
+    return nbUpdates;
+}
+
+unsigned long StateEstimator::getNbDropped() const
+{
+    return nbDropped;
+}
+
+void StateEstimator::run()
+{
+    SensorSample sample;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running)
+    {
+        condition.wait(lock, [this] { return !running || reset || queueBegin != queueEnd; });
+
+        if (reset)
+        {
+            ekf.init(resetTime, resetState);
+            reset = false;
+        }
+
+        while (running && !reset && queueBegin != queueEnd)
+        {
+            sample = queue[queueBegin % QUEUE_SIZE];
+            queueBegin++;
+            processing = true;
+
+            // the filter runs without the lock, so that push and getEstimate never wait for it
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            if (sample.type == SensorSample::IMU)
+                ekf.predict(sample);
+            else
+                ekf.correct(sample);
+            State x = ekf.getState();
+            double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            lock.lock();
+            processing = false;
+
+            if (reset)
+                break;
+            estimate = x;
+            estimateTime = ekf.getTime();
+            updateTime = updateTime + duration;
+            nbUpdates++;
+        }
+        idle.notify_all();
+    }
+}
@@ -0,0 +1,212 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+#include "stlmesh.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+bool StlMesh::load(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::streamoff size = file.tellg();
+    file.seekg(0);
+    triangles.clear();
+
+    // a binary file has an 80 bytes header, the number of triangles, and 50 bytes per triangle
+    char header[80];
+    uint32_t nbTriangles = 0;
+    if (size >= 84 && file.read(header, 80) && file.read((char*)&nbTriangles, 4) && size == 84 + 50*(std::streamoff)nbTriangles)
+    {
+        triangles.resize(nbTriangles);
+        for (Triangle &triangle : triangles)
+        {
+            float normal[3];
+            uint16_t attributes;
+            file.read((char*)normal, sizeof(normal));
+            file.read((char*)triangle.data(), sizeof(float)*9);
+            file.read((char*)&attributes, sizeof(attributes));
+        }
+        return (bool)file;
+    }
+
+    // otherwise an ASCII file, in which only the vertices matter
+    file.clear();
+    file.seekg(0);
+    std::string word;
+    Triangle triangle;
+    unsigned int nbVertices = 0;
+    while (file >> word)
+    {
+        if (word != "vertex")
+            continue;
+        file >> triangle[3*nbVertices] >> triangle[3*nbVertices+1] >> triangle[3*nbVertices+2];
+        if (++nbVertices == 3)
+        {
+            triangles.push_back(triangle);
+            nbVertices = 0;
+        }
+    }
+    return !triangles.empty();
+}
+
+bool StlMesh::save(const std::string &filename) const
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file)
+        return false;
+
+    char header[80] = {};
+    std::strncpy(header, "decimated by ProjectSupaero", sizeof(header));
+    uint32_t nbTriangles = triangles.size();
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(&nbTriangles, sizeof(nbTriangles), 1, file);
+
+    for (const Triangle &t : triangles)
+    {
+        float u[3] = {t[3]-t[0], t[4]-t[1], t[5]-t[2]};
+        float v[3] = {t[6]-t[0], t[7]-t[1], t[8]-t[2]};
+        float n[3] = {u[1]*v[2]-u[2]*v[1], u[2]*v[0]-u[0]*v[2], u[0]*v[1]-u[1]*v[0]};
+        float length = std::sqrt(n[0]*n[0]+n[1]*n[1]+n[2]*n[2]);
+        for (float &c : n)
+            c = length > 0.f ? c/length : 0.f;
+
+        uint16_t attributes = 0;
+        fwrite(n, sizeof(float), 3, file);
+        fwrite(t.data(), sizeof(float), 9, file);
+        fwrite(&attributes, sizeof(attributes), 1, file);
+    }
+
+    return fclose(file) == 0;
+}
+
+void StlMesh::decimate(float cellSize)
+{
+    // cluster of each cell, with the sum of its vertices
+    std::map<std::array<int,3>, unsigned int> clusters;
+    std::vector<std::array<double,4> > sums;
+    std::vector<std::array<unsigned int,3> > faces;
+    faces.reserve(triangles.size());
+
+    for (const Triangle &t : triangles)
+    {
+        std::array<unsigned int,3> face;
+        for (int i = 0; i < 3; i++)
+        {
+            std::array<int,3> cell = {{(int)std::floor(t[3*i]/cellSize), (int)std::floor(t[3*i+1]/cellSize),
+                                       (int)std::floor(t[3*i+2]/cellSize)}};
+            auto cluster = clusters.insert(std::make_pair(cell, (unsigned int)sums.size()));
+            if (cluster.second)
+                sums.push_back({{0., 0., 0., 0.}});
+            std::array<double,4> &sum = sums[cluster.first->second];
+            sum[0] += t[3*i];
+            sum[1] += t[3*i+1];
+            sum[2] += t[3*i+2];
+            sum[3] += 1.;
+            face[i] = cluster.first->second;
+        }
+        faces.push_back(face);
+    }
+
+    // keep the faces between three distinct clusters, once whatever their orientation
+    std::set<std::array<unsigned int,3> > kept;
+    std::vector<Triangle> decimated;
+    for (const auto &face : faces)
+    {
+        if (face[0] == face[1] || face[1] == face[2] || face[2] == face[0])
+            continue;
+        std::array<unsigned int,3> sorted = face;
+        std::sort(sorted.begin(), sorted.end());
+        if (!kept.insert(sorted).second)
+            continue;
+
+        Triangle t;
+        for (int i = 0; i < 3; i++)
+        {
+            const std::array<double,4> &sum = sums[face[i]];
+            t[3*i] = sum[0]/sum[3];
+            t[3*i+1] = sum[1]/sum[3];
+            t[3*i+2] = sum[2]/sum[3];
+        }
+        decimated.push_back(t);
+    }
+    triangles.swap(decimated);
+}
+
+unsigned int StlMesh::getNbTriangles() const
+{
+    return triangles.size();
+}
+
+std::string StlMesh::cached(const std::string &filename, float cellSize)
+{
+    struct stat source;
+    if (stat(filename.c_str(), &source) != 0)
+        return filename;
+
+    // one cache file per source and cell size, e.g. /tmp/ProjectSupaero_quadrotor_base_3f2a9c0d41e7b685_0.01.stl. The
+    // hash (FNV-1a) of the absolute path of the source tells apart the sources with the same name.
+    char *absolute = realpath(filename.c_str(), nullptr);
+    std::string path = absolute ? absolute : filename;
+    std::free(absolute);
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : path)
+        hash = (hash ^ c)*1099511628211ull;
+
+    std::string name = filename.substr(filename.find_last_of('/') + 1);
+    name = name.substr(0, name.find_last_of('.'));
+    const char *directory = std::getenv("TMPDIR");
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), "_%016llx_%g.stl", (unsigned long long)hash, cellSize);
+    std::string cache = std::string(directory ? directory : "/tmp") + "/ProjectSupaero_" + name + suffix;
+
+    struct stat cacheStat;
+    if (stat(cache.c_str(), &cacheStat) == 0 && cacheStat.st_mtime >= source.st_mtime)
+        return cache;
+
+    StlMesh mesh;
+    if (!mesh.load(filename))
+        return filename;
+    mesh.decimate(cellSize);
+
+    // written under a name of its own then renamed, so that the processes started at the same time never read a
+    // partial file
+    std::string temporary = cache + "." + std::to_string(getpid()) + ".tmp";
+    if (mesh.getNbTriangles() == 0 || !mesh.save(temporary) || rename(temporary.c_str(), cache.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        return filename;
+    }
+    return cache;
+}
@@ -0,0 +1,286 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+
+#include "tiledenvironment.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sys/stat.h>
+
+namespace
+{
+    // File of the directory which holds the size of the tiles
+    const char *INDEX_FILE = "/tiles.txt";
+}
+
+
+TiledEnvironment::TiledEnvironment(const std::string &directory, unsigned int maxCachedTiles, int activeRadius,
+                                   double lookAhead):
+    directory(directory),
+    tileSize(0.f),
+    maxCachedTiles(maxCachedTiles),
+    activeRadius(activeRadius),
+    lookAhead(lookAhead),
+    statistics(),
+    totalLoadTime(0.),
+    nbLoads(0),
+    running(true)
+{
+    // the cache must hold the active tiles and the ones prefetched around the next position
+    unsigned int window = (2*activeRadius+1)*(2*activeRadius+1);
+    this->maxCachedTiles = std::max(maxCachedTiles, 2*window);
+
+    std::ifstream index(directory + INDEX_FILE);
+    if (!(index >> tileSize) || tileSize <= 0.f)
+    {
+        tileSize = 0.f;
+        return;
+    }
+
+    thread = std::thread(&TiledEnvironment::run, this);
+}
+
+TiledEnvironment::~TiledEnvironment()
+{
+    // set under the lock, so that the thread cannot miss it between its check and its wait
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_one();
+    if (thread.joinable())
+        thread.join();
+}
+
+bool TiledEnvironment::build(const std::vector<Ecylinder> &cylinders, const std::string &directory, float tileSize)
+{
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+
+    // a cylinder goes in every tile overlapped by its bounding box
+    std::map<std::pair<int,int>, std::vector<Ecylinder> > tiles;
+    for (const Ecylinder &c : cylinders)
+    {
+        int iMin = std::floor((std::min(c.x1, c.x2) - c.radius)/tileSize);
+        int iMax = std::floor((std::max(c.x1, c.x2) + c.radius)/tileSize);
+        int jMin = std::floor((std::min(c.y1, c.y2) - c.radius)/tileSize);
+        int jMax = std::floor((std::max(c.y1, c.y2) + c.radius)/tileSize);
+        for (int i = iMin; i <= iMax; i++)
+            for (int j = jMin; j <= jMax; j++)
+                tiles[std::make_pair(i, j)].push_back(c);
+    }
+
+    bool written = true;
+    for (const auto &tile : tiles)
+        written = EnvironmentParser::write(tileFile(directory, tile.first.first, tile.first.second), tile.second) && written;
+
+    std::ofstream index(directory + INDEX_FILE);
+    index << tileSize << std::endl;
+    return written && index.good();
+}
+
+bool TiledEnvironment::isOpen() const
+{
+    return tileSize > 0.f;
+}
+
+bool TiledEnvironment::pollDelta(double x, double y, double vx, double vy, EnvironmentDelta &delta)
+{
+    delta.added.clear();
+    delta.removed.clear();
+    if (!isOpen())
+        return false;
+
+    // tiles around the drone
+    int ci = tileIndex(x), cj = tileIndex(y);
+    std::vector<int64_t> tiles;
+    for (int i = ci-activeRadius; i <= ci+activeRadius; i++)
+        for (int j = cj-activeRadius; j <= cj+activeRadius; j++)
+            tiles.push_back(tileKey(i, j));
+    std::sort(tiles.begin(), tiles.end());
+
+    std::vector<int64_t> entered, left;
+    std::set_difference(tiles.begin(), tiles.end(), activeTiles.begin(), activeTiles.end(), std::back_inserter(entered));
+    std::set_difference(activeTiles.begin(), activeTiles.end(), tiles.begin(), tiles.end(), std::back_inserter(left));
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // the active tiles are the most recently used, so that they are evicted last
+    for (int64_t key : tiles)
+    {
+        auto cached = cache.find(key);
+        if (cached != cache.end())
+            recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, cached->second.second);
+    }
+
+    for (int64_t key : entered)
+    {
+        EnvironmentPtr tile;
+        auto cached = cache.find(key);
+        if (cached != cache.end())
+        {
+            tile = cached->second.first;
+            statistics.hits++;
+        }
+        else
+        {
+            // the drone needs the tile now, load it without waiting for the thread
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            tile = load(key);
+            double loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            lock.lock();
+            statistics.misses++;
+            insert(key, tile, loadTime);
+        }
+
+        std::vector<unsigned int> &ids = activeTileIds[key];
+        for (const ObstaclePtr &o : tile->getObstacles())
+        {
+            ids.push_back(o->cylinder.id);
+            if (activeIds[o->cylinder.id]++ == 0)
+                delta.added.push_back(o);
+        }
+    }
+
+    // the cylinders of a tile which left are the ones it held when it entered, it may have been evicted since. The
+    // entered tiles are counted first, so that the cylinders they share with it stay active
+    for (int64_t key : left)
+    {
+        auto tile = activeTileIds.find(key);
+        for (unsigned int id : tile->second)
+        {
+            auto active = activeIds.find(id);
+            if (active != activeIds.end() && --active->second == 0)
+            {
+                activeIds.erase(active);
+                delta.removed.push_back(id);
+            }
+        }
+        activeTileIds.erase(tile);
+    }
+    activeTiles = tiles;
+
+    // prefetch the tiles around the position ahead of the drone
+    int pi = tileIndex(x + vx*lookAhead), pj = tileIndex(y + vy*lookAhead);
+    prefetchQueue.clear();
+    for (int i = pi-activeRadius; i <= pi+activeRadius; i++)
+        for (int j = pj-activeRadius; j <= pj+activeRadius; j++)
+            if (cache.find(tileKey(i, j)) == cache.end())
+                prefetchQueue.push_back(tileKey(i, j));
+    bool prefetch = !prefetchQueue.empty();
+    lock.unlock();
+    if (prefetch)
+        condition.notify_one();
+
+    return !delta.added.empty() || !delta.removed.empty();
+}
+
+TileStatistics TiledEnvironment::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    TileStatistics s = statistics;
+    s.nbCached = cache.size();
+    s.meanLoadTime = nbLoads > 0 ? totalLoadTime/nbLoads : 0.;
+    return s;
+}
+
+float TiledEnvironment::getTileSize() const
+{
+    return tileSize;
+}
+
+std::string TiledEnvironment::tileFile(const std::string &directory, int i, int j)
+{
+    return directory + "/" + std::to_string(i) + "_" + std::to_string(j) + ".xml";
+}
+
+EnvironmentPtr TiledEnvironment::load(int64_t key) const
+{
+    int i = (int)(key >> 32), j = (int)(key & 0xFFFFFFFF);
+    EnvironmentParser parser(tileFile(directory, i, j));
+    if (!parser.isLoaded())
+        return Environment::create({});
+    return parser.readEnvironment();
+}
+
+void TiledEnvironment::insert(int64_t key, const EnvironmentPtr &tile, double loadTime)
+{
+    totalLoadTime += loadTime;
+    nbLoads++;
+    statistics.maxLoadTime = std::max(statistics.maxLoadTime, loadTime);
+
+    // another load of the same tile may have finished first
+    if (cache.find(key) != cache.end())
+        return;
+
+    recentlyUsed.push_front(key);
+    cache[key] = std::make_pair(tile, recentlyUsed.begin());
+    while (cache.size() > maxCachedTiles)
+    {
+        cache.erase(recentlyUsed.back());
+        recentlyUsed.pop_back();
+        statistics.evicted++;
+    }
+}
+
+void TiledEnvironment::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running)
+    {
+        condition.wait(lock, [this] { return !running || !prefetchQueue.empty(); });
+
+        while (running && !prefetchQueue.empty())
+        {
+            int64_t key = prefetchQueue.back();
+            prefetchQueue.pop_back();
+            if (cache.find(key) != cache.end())
+                continue;
+
+            lock.unlock();
+            auto start = std::chrono::steady_clock::now();
+            EnvironmentPtr tile = load(key);
+            double loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            lock.lock();
+
+            // the cache holds twice the active tiles, so the prefetched ones never evict the active ones
+            statistics.prefetched++;
+            insert(key, tile, loadTime);
+        }
+    }
+}
+
+int64_t TiledEnvironment::tileKey(int i, int j)
+{
+    return ((int64_t)i << 32) | (uint32_t)j;
+}
+
+int TiledEnvironment::tileIndex(double coordinate) const
+{
+    return (int)std::floor(coordinate/tileSize);
+}
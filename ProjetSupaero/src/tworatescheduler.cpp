@@ -0,0 +1,76 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+#include <algorithm>
+#include <cmath>
+#include "tworatescheduler.h"
+
+TwoRateScheduler::TwoRateScheduler(double innerPeriod, double outerPeriod, double start)
+    : innerPeriod(innerPeriod), ratio(std::max(1l, std::lround(outerPeriod/innerPeriod))), start(start),
+      innerTicks(0), outerTicks(0)
+{
+}
+
+unsigned int TwoRateScheduler::advance(double t, const Task &inner, const Task &outer)
+{
+    unsigned int nbTicks = 0;
+    // a tick is due once the clock reaches its time, up to a small tolerance on the sum of the periods
+    while (start + innerTicks*innerPeriod <= t + 1e-9*innerPeriod)
+    {
+        double tick = start + innerTicks*innerPeriod;
+        if (innerTicks % ratio == 0)
+        {
+            outer(tick);
+            outerTicks++;
+        }
+        inner(tick);
+        innerTicks++;
+        nbTicks++;
+    }
+    return nbTicks;
+}
+
+double TwoRateScheduler::getTime() const
+{
+    return start + (innerTicks == 0 ? 0. : (innerTicks-1)*innerPeriod);
+}
+
+double TwoRateScheduler::getInnerPeriod() const
+{
+    return innerPeriod;
+}
+
+double TwoRateScheduler::getOuterPeriod() const
+{
+    return ratio*innerPeriod;
+}
+
+unsigned long TwoRateScheduler::getInnerTicks() const
+{
+    return innerTicks;
+}
+
+unsigned long TwoRateScheduler::getOuterTicks() const
+{
+    return outerTicks;
+}
@@ -26,12 +26,17 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 #include <omniORB4/CORBA.h>
 #include <string>
 #include <cmath>
+#include <algorithm>
+#include <limits>
 #include "environmentparser.h"
+#include "posemath.h"
+#include "stlmesh.h"
 
 typedef CORBA::ULong WindowID;
 using namespace Eigen;
 
-Viewer::Viewer(): client()
+Viewer::Viewer(): client(), droneLoaded(false), dronePosition(Vector3f::Zero()), impostorsPosition(Vector3f::Zero()), impostorsDirty(true), detailChanged(false),
+    lastObstaclesUpdate(0.), detailRadius(50.f), impostorRadius(300.f), maxNodes(500), maxImpostors(300)
 {
     // create a clent window and a world scene in it
     WindowID w_id = client.createWindow("window");
@@ -44,49 +49,374 @@ Viewer::Viewer(): client()
 }
 
 
-void Viewer::createEnvironment(const std::vector<Ecylinder> &cylinder_list)
+void Viewer::createEnvironment(const Environment &environment)
 {
-    // copy cylinders to memory
-    cylinders = cylinder_list;
+    // the cylinders are grouped so that moving the world around the drone is a single configuration
+    client.createGroup("/world/environment");
 
-    // initialise color and position
-    float yellow[4] = {1.f,1.f,.1f,1.f};
+    lastObstaclesUpdate = 0.;
+    addObstacles(environment.getObstacles());
+    updateImpostors();
+    client.refresh();
+}
+
+void Viewer::setLevelOfDetail(float detailRadius, float impostorRadius, unsigned int maxNodes, unsigned int maxImpostors)
+{
+    this->detailRadius = detailRadius;
+    this->impostorRadius = impostorRadius;
+    this->maxNodes = maxNodes;
+    this->maxImpostors = maxImpostors;
+    impostorsDirty = true;
+}
+
+void Viewer::addObstacles(const std::vector<ObstaclePtr> &obstacles)
+{
+    // for each obstacle in the list, put it in the grid, the nodes are created when needed
+    for(const ObstaclePtr &obstacle : obstacles)
+    {
+        const Ecylinder &cyl = obstacle->cylinder;
+        CylinderNode &node = nodes[cyl.id];
+        node.obstacle = obstacle;
+        node.slot = -1;
+
+        if (!cyl.isStatic())
+        {
+            movingCylinders.push_back(cyl.id);
+            continue;
+        }
+
+        const Epoint &center = obstacle->shape.center;
+        Cell &cell = cells[cellKey(cellIndex(center.x), cellIndex(center.y), cellIndex(center.z))];
+        if (cell.ids.empty())
+            cell.impostor = -1;
+        cell.ids.push_back(cyl.id);
+        updateBounds(cell);
+    }
+    impostorsDirty = true;
+
+    updateCylinders(lastObstaclesUpdate);
+    client.refresh();
+}
+
+void Viewer::removeObstacles(const std::vector<unsigned int> &ids)
+{
+    for (unsigned int id : ids)
+    {
+        auto found = nodes.find(id);
+        if (found == nodes.end())
+            continue;
+
+        CylinderNode &node = found->second;
+        hideCylinder(node);
+        drawnCylinders.erase(std::remove(drawnCylinders.begin(), drawnCylinders.end(), id), drawnCylinders.end());
+
+        if (node.obstacle->cylinder.isStatic())
+        {
+            const Epoint &center = node.obstacle->shape.center;
+            int64_t key = cellKey(cellIndex(center.x), cellIndex(center.y), cellIndex(center.z));
+            Cell &cell = cells[key];
+            cell.ids.erase(std::remove(cell.ids.begin(), cell.ids.end(), id), cell.ids.end());
+            if (cell.ids.empty())
+            {
+                hideImpostor(cell);
+                cells.erase(key);
+                drawnCells.erase(std::remove(drawnCells.begin(), drawnCells.end(), key), drawnCells.end());
+            }
+            else
+                updateBounds(cell);
+        }
+        else
+            movingCylinders.erase(std::remove(movingCylinders.begin(), movingCylinders.end(), id), movingCylinders.end());
+
+        nodes.erase(found);
+    }
+    impostorsDirty = true;
+    client.refresh();
+}
+
+void Viewer::updateObstacles(double t)
+{
+    // the drawn cylinders are updated at a bounded rate, and the boxes only when the drone moved enough
+    if (t - lastObstaclesUpdate < OBSTACLES_UPDATE_PERIOD)
+        return;
+    lastObstaclesUpdate = t;
+
+    updateCylinders(t);
+    if (impostorsDirty || detailChanged || (dronePosition - impostorsPosition).norm() > CELL_SIZE/4.f)
+        updateImpostors();
+}
+
+se3::SE3 Viewer::cylinderPosition(const CylinderNode &node, double t) const
+{
+    // the orientation never changes, only the translation depends on the time
+    const Eshape &shape = node.obstacle->shape;
+    const float *q = shape.orientation;
+    Epoint o = node.obstacle->cylinder.displacement(t);
     se3::SE3 se3position = se3::SE3::Identity();
-    int i = 1;
+    se3position.rotation(Eigen::Quaternionf(q[0], q[1], q[2], q[3]).toRotationMatrix());
+    se3position.translation(Vector3f(shape.center.x + o.x, shape.center.y + o.y, shape.center.z + o.z));
+    return se3position;
+}
 
-    // for each cylinder in the list, compute translation vector and rotation matrix, and create gepetto objects.
-    for(Ecylinder cyl : cylinders)
+int Viewer::cellIndex(float coordinate)
+{
+    return (int)std::floor(coordinate/CELL_SIZE);
+}
+
+int64_t Viewer::cellKey(int i, int j, int k)
+{
+    // 21 bits for each index
+    return ((int64_t)(i & 0x1FFFFF) << 42) | ((int64_t)(j & 0x1FFFFF) << 21) | (int64_t)(k & 0x1FFFFF);
+}
+
+void Viewer::updateBounds(Cell &cell)
+{
+    cell.min.setConstant(std::numeric_limits<float>::max());
+    cell.max.setConstant(-std::numeric_limits<float>::max());
+    for (unsigned int id : cell.ids)
     {
-        string n = "/world/cylinder"+std::to_string(i++);
-        const char* name = n.c_str();
+        const Eshape &shape = nodes[id].obstacle->shape;
+        cell.min = cell.min.cwiseMin(Vector3f(shape.min.x, shape.min.y, shape.min.z));
+        cell.max = cell.max.cwiseMax(Vector3f(shape.max.x, shape.max.y, shape.max.z));
+    }
+}
 
-        float dx = cyl.x2-cyl.x1;
-        float dy = cyl.y2-cyl.y1;
-        float dz = cyl.z2-cyl.z1;
+float Viewer::cellDistance(const Cell &cell) const
+{
+    return (cell.min - dronePosition).cwiseMax(dronePosition - cell.max).cwiseMax(0.f).norm();
+}
 
-        client.addCylinder(name, cyl.radius, sqrt(pow(dx,2.f)+pow(dy,2.f)+pow(dz,2.f)), yellow);
+void Viewer::updateCylinders(double t)
+{
+    float yellow[4] = {1.f,1.f,.1f,1.f};
 
-        se3position.translation({(cyl.x1+cyl.x2)/2.f,(cyl.y1+cyl.y2)/2.f,(cyl.z1+cyl.z2)/2.f});
+    // a cell is drawn either in detail or as an impostor: all the cylinders of the cells whose bounding box is within the
+    // detail radius are candidates, the moving ones only when their bounding sphere is
+    candidates.clear();
+    cellsBuffer.clear();
+    auto distanceTo = [this](const CylinderNode &node, const Vector3f &center)
+    {
+        const Eobstacle &obstacle = *node.obstacle;
+        return (center - dronePosition).norm() - obstacle.shape.length/2.f - obstacle.cylinder.radius;
+    };
+
+    int range = (int)std::ceil(detailRadius/CELL_SIZE) + 1;
+    int ci = cellIndex(dronePosition.x()), cj = cellIndex(dronePosition.y()), ck = cellIndex(dronePosition.z());
+    for (int i = ci-range; i <= ci+range; i++)
+        for (int j = cj-range; j <= cj+range; j++)
+            for (int k = ck-range; k <= ck+range; k++)
+            {
+                int64_t key = cellKey(i, j, k);
+                auto cell = cells.find(key);
+                if (cell == cells.end() || cellDistance(cell->second) > detailRadius)
+                    continue;
+                cellsBuffer.push_back(key);
+                for (unsigned int id : cell->second.ids)
+                {
+                    const CylinderNode &node = nodes[id];
+                    const Epoint &center = node.obstacle->shape.center;
+                    candidates.push_back(std::make_pair(distanceTo(node, Vector3f(center.x, center.y, center.z)), id));
+                }
+            }
+
+    for (unsigned int id : movingCylinders)
+    {
+        const CylinderNode &node = nodes[id];
+        float distance = distanceTo(node, cylinderPosition(node, t).translation());
+        if (distance < detailRadius)
+            candidates.push_back(std::make_pair(distance, id));
+    }
 
-        double theta = atan2(dy,dx);
-        double phi = -atan2(sqrt(pow(dx,2)+pow(dy,2)),dz);
-        Matrix3d m_z = rotationMat(theta, Axis::Z);
-        Matrix3d m_y = rotationMat(phi, Axis::Y);
+    // keep the closest ones, the cells losing some of their cylinders are drawn as impostors instead
+    std::sort(cellsBuffer.begin(), cellsBuffer.end());
+    if (candidates.size() > maxNodes)
+    {
+        std::nth_element(candidates.begin(), candidates.begin() + maxNodes, candidates.end());
+        for (auto dropped = candidates.begin() + maxNodes; dropped != candidates.end(); ++dropped)
+        {
+            const Eobstacle &obstacle = *nodes[dropped->second].obstacle;
+            if (!obstacle.cylinder.isStatic())
+                continue;
+            const Epoint &center = obstacle.shape.center;
+            int64_t key = cellKey(cellIndex(center.x), cellIndex(center.y), cellIndex(center.z));
+            auto found = std::lower_bound(cellsBuffer.begin(), cellsBuffer.end(), key);
+            if (found != cellsBuffer.end() && *found == key)
+                cellsBuffer.erase(found);
+        }
+        candidates.resize(maxNodes);
+    }
+    if (cellsBuffer != detailedCells)
+    {
+        detailedCells.swap(cellsBuffer);
+        detailChanged = true;
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<float,unsigned int> &a, const std::pair<float,unsigned int> &b) { return a.second < b.second; });
 
-        se3position.rotation(m_z.cast<float>()*m_y.cast<float>());
-        client.applyConfiguration(name, se3position) ;
+    // release the nodes of the cylinders not drawn anymore, before reusing them
+    auto drawn = [this](unsigned int id)
+    {
+        return std::binary_search(candidates.begin(), candidates.end(), std::make_pair(0.f, id),
+                                  [](const std::pair<float,unsigned int> &a, const std::pair<float,unsigned int> &b) { return a.second < b.second; });
+    };
+    for (unsigned int id : drawnCylinders)
+        if (!drawn(id))
+            hideCylinder(nodes[id]);
+
+    drawnCylinders.clear();
+    for (const auto &candidate : candidates)
+    {
+        CylinderNode &node = nodes[candidate.second];
+        drawnCylinders.push_back(candidate.second);
+
+        if (node.slot < 0)
+        {
+            // a unit cylinder scaled to this one
+            if (cylinderPool.free.empty())
+            {
+                string n = "/world/environment/cylinder"+std::to_string(cylinderPool.names.size()+1);
+                client.addCylinder(n.c_str(), 1.f, 1.f, yellow);
+                cylinderPool.free.push_back(cylinderPool.names.size());
+                cylinderPool.names.push_back(n);
+            }
+            node.slot = cylinderPool.free.back();
+            cylinderPool.free.pop_back();
+
+            const Eobstacle &obstacle = *node.obstacle;
+            float scale[3] = {obstacle.cylinder.radius, obstacle.cylinder.radius, obstacle.shape.length};
+            const char *name = cylinderPool.names[node.slot].c_str();
+            client.setScale(name, scale);
+            client.applyConfiguration(name, cylinderPosition(node, t));
+            client.setVisibility(name, "ON");
+        }
+        else if (!node.obstacle->cylinder.isStatic())
+            client.applyConfiguration(cylinderPool.names[node.slot].c_str(), cylinderPosition(node, t));
     }
-    client.refresh();
 }
 
-void Viewer::createDrone(const char*  filename)
+void Viewer::updateImpostors()
 {
-    // load drone mesh
-    bool a = client.addMesh("/world/drone", filename) ;
-    if(a == 0)
-        std::cout << "Erreur de chargement du modèle du drone"<< std::endl;
+    float grey[4] = {.6f,.6f,.5f,.4f};
+    bool boundsChanged = impostorsDirty;
+    impostorsPosition = dronePosition;
+    impostorsDirty = false;
+    detailChanged = false;
+
+    // distance between the drone and the bounding box of the cells, for the cells not drawn in detail
+    cellCandidates.clear();
+    auto consider = [this](const Cell &cell, int64_t key)
+    {
+        float distance = cellDistance(cell);
+        if (distance < impostorRadius && !std::binary_search(detailedCells.begin(), detailedCells.end(), key))
+            cellCandidates.push_back(std::make_pair(distance, key));
+    };
+
+    // look the cells up around the drone, or go through all of them when there are fewer
+    int range = (int)std::ceil(impostorRadius/CELL_SIZE) + 1;
+    if (cells.size() < (size_t)(2*range+1)*(2*range+1)*(2*range+1))
+    {
+        for (const auto &cell : cells)
+            consider(cell.second, cell.first);
+    }
+    else
+    {
+        int ci = cellIndex(dronePosition.x()), cj = cellIndex(dronePosition.y()), ck = cellIndex(dronePosition.z());
+        for (int i = ci-range; i <= ci+range; i++)
+            for (int j = cj-range; j <= cj+range; j++)
+                for (int k = ck-range; k <= ck+range; k++)
+                {
+                    int64_t key = cellKey(i, j, k);
+                    auto cell = cells.find(key);
+                    if (cell != cells.end())
+                        consider(cell->second, key);
+                }
+    }
+
+    // keep the closest ones
+    if (cellCandidates.size() > maxImpostors)
+    {
+        std::nth_element(cellCandidates.begin(), cellCandidates.begin() + maxImpostors, cellCandidates.end());
+        cellCandidates.resize(maxImpostors);
+    }
+    std::sort(cellCandidates.begin(), cellCandidates.end(),
+              [](const std::pair<float,int64_t> &a, const std::pair<float,int64_t> &b) { return a.second < b.second; });
+
+    // release the boxes of the cells not drawn anymore, before reusing them
+    for (int64_t key : drawnCells)
+    {
+        bool drawn = std::binary_search(cellCandidates.begin(), cellCandidates.end(), std::make_pair(0.f, key),
+                                        [](const std::pair<float,int64_t> &a, const std::pair<float,int64_t> &b) { return a.second < b.second; });
+        if (!drawn)
+            hideImpostor(cells[key]);
+    }
+
+    drawnCells.clear();
+    for (const auto &candidate : cellCandidates)
+    {
+        Cell &cell = cells[candidate.second];
+        drawnCells.push_back(candidate.second);
+
+        bool created = cell.impostor < 0;
+        if (created)
+        {
+            // a unit box scaled to the bounding box of the cell
+            if (impostorPool.free.empty())
+            {
+                string n = "/world/environment/impostor"+std::to_string(impostorPool.names.size()+1);
+                client.addBox(n.c_str(), 1.f, 1.f, 1.f, grey);
+                impostorPool.free.push_back(impostorPool.names.size());
+                impostorPool.names.push_back(n);
+            }
+            cell.impostor = impostorPool.free.back();
+            impostorPool.free.pop_back();
+            client.setVisibility(impostorPool.names[cell.impostor].c_str(), "ON");
+        }
+
+        if (created || boundsChanged)
+        {
+            const char *name = impostorPool.names[cell.impostor].c_str();
+            Vector3f size = cell.max - cell.min;
+            se3::SE3 se3position = se3::SE3::Identity();
+            se3position.translation((cell.min + cell.max)/2.f);
+            client.setScale(name, size.data());
+            client.applyConfiguration(name, se3position);
+        }
+    }
+}
+
+void Viewer::hideCylinder(CylinderNode &node)
+{
+    if (node.slot < 0)
+        return;
+    client.setVisibility(cylinderPool.names[node.slot].c_str(), "OFF");
+    cylinderPool.free.push_back(node.slot);
+    node.slot = -1;
+}
+
+void Viewer::hideImpostor(Cell &cell)
+{
+    if (cell.impostor < 0)
+        return;
+    client.setVisibility(impostorPool.names[cell.impostor].c_str(), "OFF");
+    impostorPool.free.push_back(cell.impostor);
+    cell.impostor = -1;
+}
+
+bool Viewer::createDrone(const char*  filename, float decimation)
+{
+    // load the drone mesh once, decimated and cached, outside of the scene: it is only drawn where the drones instance it
+    std::string mesh = filename;
+    if (decimation > 0.f && mesh.size() > 4 && mesh.compare(mesh.size()-4, 4, ".stl") == 0)
+        mesh = StlMesh::cached(mesh, decimation);
+
+    droneLoaded = client.addMesh(DRONE_MESH_NODE, mesh.c_str());
+    if (!droneLoaded)
+        std::cout << "Erreur de chargement du modèle du drone " << mesh << std::endl;
 
     // create gepetto object for the drone
+    client.createGroup("/world/drone");
+    if (droneLoaded)
+        client.addToGroup(DRONE_MESH_NODE, "/world/drone");
     se3::SE3 se3position = se3::SE3::Identity();
     se3position.translation({0.,0.,1.});
     client.applyConfiguration("/world/drone", se3position);
@@ -96,48 +426,59 @@ void Viewer::createDrone(const char*  filename)
     client.addCylinder("/world/arrow", .1f, 4.f, red);
 
     client.refresh();
+    return droneLoaded;
 }
 
-void Viewer::moveDrone(double x, double y, double z, double roll, double pitch, double yaw)
+bool Viewer::addDrone(const std::string &name)
 {
-    // This member function does not move the drone but the world around it. Indeed, we want the camera to be centered on the drone
-
-    // first translate the cylinders
-    se3::SE3 se3position = se3::SE3::Identity();
-
-    // for each cylinder in the list, compute translation vector and rotation matrix, and move them
-    for(unsigned int i=0 ; i<cylinders.size(); i++)
-    {
-        Ecylinder cyl = cylinders[i];
-        string n = "/world/cylinder"+std::to_string(i+1);
+    if (!droneLoaded)
+        return false;
 
-        se3position.translation({(cyl.x1+cyl.x2)/2.f - (float)x,(cyl.y1+cyl.y2)/2.f - (float)y,(cyl.z1+cyl.z2)/2.f - (float)z});
-
-        float dx = cyl.x2-cyl.x1;
-        float dy = cyl.y2-cyl.y1;
-        float dz = cyl.z2-cyl.z1;
+    // the other drones are in the environment group, which moves around the main drone
+    std::string group = "/world/environment/" + name;
+    client.createGroup(group.c_str());
+    return client.addToGroup(DRONE_MESH_NODE, group.c_str());
+}
 
-        double theta = atan2(dy,dx);
-        double phi = -atan2(sqrt(pow(dx,2)+pow(dy,2)),dz);
-        Matrix3d m_z = rotationMat(theta, Axis::Z);
-        Matrix3d m_y = rotationMat(phi, Axis::Y);
+void Viewer::placeDrone(const std::string &name, double x, double y, double z, double qw, double qx, double qy, double qz)
+{
+    se3::SE3 se3position = se3::SE3::Identity();
+    se3position.translation({(float)x, (float)y, (float)z});
+    se3position.rotation(Quaternionf((float)qw, (float)qx, (float)qy, (float)qz).normalized().toRotationMatrix());
+    client.applyConfiguration(("/world/environment/" + name).c_str(), se3position);
+}
 
-        se3position.rotation(m_z.cast<float>()*m_y.cast<float>());
+void Viewer::moveDrone(double x, double y, double z, double roll, double pitch, double yaw)
+{
+    centerOn(x, y, z);
 
-        client.applyConfiguration(n.c_str(), se3position);
-    }
+    // apply the rotation Rx(roll)*Ry(pitch)*Rz(yaw) of the model to the drone, the same as the quaternion path
+    se3Drone.rotation() = PoseMath::rpyOrientation((float)roll, (float)pitch, (float)yaw).toRotationMatrix();
+    client.applyConfiguration("/world/drone", se3Drone);
+    client.refresh();
+}
 
-    // compute rotation matrices for the drone
-    Matrix3d m_roll = rotationMat(roll, Axis::X);
-    Matrix3d m_pitch = rotationMat(-pitch, Axis::Y);
-    Matrix3d m_yaw = rotationMat(yaw, Axis::Z);
+void Viewer::moveDrone(double x, double y, double z, double qw, double qx, double qy, double qz)
+{
+    centerOn(x, y, z);
 
-    // apply rotation matrices to the drone
-    se3Drone.rotation() = m_yaw.cast<float>() * m_pitch.cast<float>() * m_roll.cast<float>();
+    se3Drone.rotation() = Quaternionf((float)qw, (float)qx, (float)qy, (float)qz).normalized().toRotationMatrix();
     client.applyConfiguration("/world/drone", se3Drone);
     client.refresh();
 }
 
+void Viewer::centerOn(double x, double y, double z)
+{
+    // This does not move the drone but the world around it. Indeed, we want the camera to be centered on the drone
+    // translate the group of cylinders
+    se3::SE3 se3position = se3::SE3::Identity();
+    se3position.translation({-(float)x, -(float)y, -(float)z});
+    client.applyConfiguration("/world/environment", se3position);
+
+    // the cylinders drawn are chosen around this position
+    dronePosition = Vector3f((float)x, (float)y, (float)z);
+}
+
 void Viewer::setArrow(int vx, int vy, int vz)
 {
     auto dronePos = se3Drone.translation();
@@ -151,72 +492,10 @@ void Viewer::setArrow(int vx, int vy, int vz)
         // translate the arrow next to the drone
         se3position.translation({ dronePos[0] + 2.5f*(float)vx , dronePos[1] + 2.5f*(float)vy, dronePos[2] + 2.5f*(float)vz });
 
-        // compute the rotation matrices
-        double theta = atan2(vy,vx);
-        double phi = -atan2(sqrt(pow(vx,2)+pow(vy,2)),vz);
-        Matrix3d m_z = rotationMat(theta, Axis::Z);
-        Matrix3d m_y = rotationMat(phi, Axis::Y);
-
-        se3position.rotation(m_z.cast<float>()*m_y.cast<float>());
+        // point the arrow along the speed command
+        se3position.rotation(PoseMath::axisOrientation((float)vx, (float)vy, (float)vz).toRotationMatrix());
     }
     // apply translation and rotations
     client.applyConfiguration("/world/arrow", se3position);
     client.refresh();
 }
-
-Matrix3d Viewer::rotationMat(double angle, Axis axis)
-{
-    Matrix3d mat(3,3);
-    double c = cos(angle), s = sin(angle);
-
-    switch (axis)
-    {
-    case Axis::X:
-        mat(0,0) = 1.;
-        mat(0,1) = 0.;
-        mat(0,2) = 0.;
-
-        mat(1,0) = 0.;
-        mat(1,1) = c;
-        mat(1,2) = -s;
-
-        mat(2,0) = 0.;
-        mat(2,1) = s;
-        mat(2,2) = c;
-        break;
-
-    case Axis::Y:
-        mat(0,0) = c;
-        mat(0,1) = 0.;
-        mat(0,2) = -s;
-
-        mat(1,0) = 0.;
-        mat(1,1) = 1.;
-        mat(1,2) = 0.;
-
-        mat(2,0) = s;
-        mat(2,1) = 0.;
-        mat(2,2) = c;
-        break;
-
-    case Axis::Z:
-        mat(0,0) = c;
-        mat(0,1) = -s;
-        mat(0,2) = 0.;
-
-        mat(1,0) = s;
-        mat(1,1) = c;
-        mat(1,2) = 0.;
-
-        mat(2,0) = 0.;
-        mat(2,1) = 0.;
-        mat(2,2) = 1.;
-        break;
-
-    default:
-        break;
-    }
-
-    return mat;
-}
-
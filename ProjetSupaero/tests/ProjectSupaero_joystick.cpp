@@ -25,6 +25,14 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 #include <string>
 #include <ctime>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/resource.h>
 
 #include <acado_toolkit.hpp>
 #include <acado_optimal_control.hpp>
@@ -33,140 +41,188 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 #include "input.h"
 #include "viewer.h"
 #include "environmentparser.h"
+#include "mpcsolver.h"
+#include "environmentwatcher.h"
+#include "tiledenvironment.h"
+#include "referencegenerator.h"
+#include "explicitcontroller.h"
+#include "hoverlqr.h"
+#include "tworatescheduler.h"
+#include "sharedstate.h"
+#include "sensormodel.h"
+#include "stateestimator.h"
+#include "simulationclock.h"
+#include "eventtriggeredmpc.h"
+#include "realtime.h"
+#include "allocationtracker.h"
 
 using std::cout; using std::endl;
 
+// Time budget of the MPC when it checks the explicit controller, in seconds
+const double EXPLICIT_BUDGET = 0.01;
 
-int main()
-{
-    USING_NAMESPACE_ACADO;
+// Difference of propeller velocity, in rad/s, above which the MPC overrides the command of the explicit controller
+const double EXPLICIT_TOLERANCE = 5.;
 
-    // INTRODUCE THE VARIABLES:
-    // -------------------------
-    DifferentialState x,y,z, vx,vy,vz, phi,theta,psi, p,q,r;// u1,u2,u3,u4;
-    // x, y, z : position
-    // vx, vy, vz : linear velocity
-    // phi, theta, psi : orientation (Yaw-Pitch-Roll = Euler(3,2,1))
-    // p, q, r : angular velocity
-    // u1, u2, u3, u4 : velocity of the propellers
-    Control u1,u2,u3,u4;
-    // vu1, vu2, vu3, vu4 : derivative of u1, u2, u3, u4
-
-    // Quad constants
-    const double c  = 0.00001;
-    const double Cf = 0.00065;
-    const double d  = 0.250;
-    const double Jx = 0.018;
-    const double Jy = 0.018;
-    const double Jz = 0.026;
-    const double m  = 0.9;
-    const double g  = 9.81;
-
-    // DEFINE A DIFFERENTIAL EQUATION:
-    // -------------------------------
-    DifferentialEquation f;
-
-    f << dot(x) == vx;
-    f << dot(y) == vy;
-    f << dot(z) == vz;
-    f << dot(vx) == Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*sin(theta)/m;
-    f << dot(vy) == -Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*sin(psi)*cos(theta)/m;
-    f << dot(vz) == Cf*(u1*u1+u2*u2+u3*u3+u4*u4)*cos(psi)*cos(theta)/m - g;
-    f << dot(phi) == -cos(phi)*tan(theta)*p+sin(phi)*tan(theta)*q+r;
-    f << dot(theta) == sin(phi)*p+cos(phi)*q;
-    f << dot(psi) == cos(phi)/cos(theta)*p-sin(phi)/cos(theta)*q;
-    f << dot(p) == (d*Cf*(u1*u1-u2*u2)+(Jy-Jz)*q*r)/Jx;
-    f << dot(q) == (d*Cf*(u4*u4-u3*u3)+(Jz-Jx)*p*r)/Jy;
-    f << dot(r) == (c*(u1*u1+u2*u2-u3*u3-u4*u4)+(Jx-Jy)*p*q)/Jz;
-/*    f << dot(u1) == vu1;
-    f << dot(u2) == vu2;
-    f << dot(u3) == vu3;
-    f << dot(u4) == vu4;
-*/
+// Periods of the LQR inner loop and of the MPC outer loop, in seconds
+const double INNER_PERIOD = 0.001;
+const double OUTER_PERIOD = 0.02;
 
-    // SET UP THE SIMULATED PROCESS:
-    // -----------------------------
-    DynamicSystem dynamicSystem(f,OutputFcn{});
-    Process process(dynamicSystem,INT_RK45);
+// Speed reference of the headless mode: fly forward at 1 m/s
+const std::array<double,6> HEADLESS_REFERENCE = {0., 1., 0., 0., 0., 0.};
 
+// Time constant of the propellers when the actuator model is driven by a velocity command, in seconds
+const double PROPELLER_TIME_CONSTANT = 0.02;
 
-    // DEFINE LEAST SQUARE FUNCTION:
-    // -----------------------------
-    Function h;
-    h << vx << vy << vz;
-//    h << vu1 << vu2 << vu3 << vu4;
-    h << u1 << u2 << u3 << u4;
-    h << p << q << r;
-
-    // LSQ coefficient matrix
-    DMatrix Q(10,10);
-    Q(0,0) = Q(1,1) = Q(2,2) = 1e-1;
-    Q(3,3) = Q(4,4) = Q(5,5) = Q(6,6) = 1e-9;
-    Q(7,7) = Q(8,8) = Q(9,9) = 1e-1;
-
-    // Reference
-    DVector refVec(10);
-    refVec.setZero(10);
-
-
-    // DEFINE AN OPTIMAL CONTROL PROBLEM:
-    // ----------------------------------
-    OCP ocp(0., 1., 4);
-
-    ocp.minimizeLSQ(Q, h, refVec);
-
-    // Constraints on the velocity of each propeller
-    ocp.subjectTo(f);
-    ocp.subjectTo(16 <= u1 <= 95);
-    ocp.subjectTo(16 <= u2 <= 95);
-    ocp.subjectTo(16 <= u3 <= 95);
-    ocp.subjectTo(16 <= u4 <= 95);
-
-    // Command constraints
-    // Constraints on the acceleration of each propeller
-/*    ocp.subjectTo(-200 <= vu1 <= 200);
-    ocp.subjectTo(-200 <= vu2 <= 200);
-    ocp.subjectTo(-200 <= vu3 <= 200);
-    ocp.subjectTo(-200 <= vu4 <= 200);
-*/
-    // Constraint to avoid singularity
-    ocp.subjectTo(-1. <= theta <= 1.);
-
-    // Adding roof, floor and walls constraints
-/*    ocp.subjectTo(-9.7 <= x <= 9.7);
-    ocp.subjectTo(-9.7 <= y <= 9.7);
-    ocp.subjectTo(.3 <= z <= 9.7);
-*/
-    // Loading cylindrical obstacles from XML
-    EnvironmentParser parser(PIE_SOURCE_DIR"/data/envsave.xml");
-    auto cylinders = parser.readData();
-    for (Ecylinder c : cylinders)
+// Iterations of the loop before its steady state, when the allocations are tracked, and number of iterations whose
+// allocations are printed
+const unsigned long ALLOCATION_WARMUP = 100;
+const unsigned long ALLOCATION_REPORTS = 3;
+
+// Slack above which a soft constraint counts as violated, smaller ones are round-off of the QP solver
+const double SLACK_TOLERANCE = 1e-6;
+
+// State of the drone with Euler angles, whatever the attitude model of the solver. The propeller velocities of the
+// actuator model come after the drone states and are ignored.
+DroneModel::State eulerState(const ACADO::DVector &X, bool quaternion)
+{
+    if (!quaternion)
     {
-        ocp.subjectTo(pow(c.radius + 1,2) <=
-                      ( pow((y-c.y1)*(c.z2-c.z1)-(c.y2-c.y1)*(z-c.z1),2) + pow((z-c.z1)*(c.x2-c.x1)-(c.z2-c.z1)*(x-c.x1),2) + pow((x-c.x1)*(c.y2-c.y1)-(c.x2-c.x1)*(y-c.y1),2) ) /
-                      ( pow(c.x2-c.x1,2) + pow(c.y2-c.y1,2) + pow(c.z2-c.z1,2) )
-                      );
+        DroneModel::State x;
+        for (unsigned int i = 0; i < MPCSolver::NB_STATES; i++)
+            x(i) = X(i);
+        return x;
     }
 
+    DroneModel::QuaternionState x;
+    for (unsigned int i = 0; i < MPCSolver::NB_STATES_QUATERNION; i++)
+        x(i) = X(i);
+    return DroneModel::toEulerState(x);
+}
+
+
+int main(int argc, char *argv[])
+{
+    USING_NAMESPACE_ACADO;
+    auto startupTime = std::chrono::steady_clock::now();
+
+    // Options: --lqr runs the MPC at a lower rate and an LQR tracking its prediction at a high rate, --quaternion uses
+    // quaternions for the attitude, --ekf gives the controllers the state estimated from simulated sensors, --actuators
+    // adds the propeller velocities to the model and controls their accelerations, --event solves the MPC only when its
+    // last prediction is no longer valid and plays the predicted controls back in between, --cylinders constrains the
+    // distance to the obstacles instead of keeping the drone in a corridor of half-spaces. --lockstep simulates fixed steps as
+    // fast as possible, --scale <factor> runs the simulated time faster or slower than the wall clock, --headless
+    // <seconds> flies a fixed reference in lockstep for the given duration, without viewer nor keyboard. --tiles <directory>
+    // streams the obstacles from a tiled environment (see tile_environment) instead of the environment file.
+    // --realtime <cpu> pins the control loop to a core with the SCHED_FIFO policy and locks the memory, --track-allocations
+    // counts the heap allocations of each iteration of the loop in steady state and prints the backtraces of the first
+    // ones. Any other argument is the file of an explicit approximation of the MPC (see train_explicit_mpc).
+    bool useLQR = false, useQuaternion = false, useEKF = false, useActuators = false, useEvents = false, useCylinders = false;
+    ClockMode clockMode = ClockMode::REAL_TIME;
+    double timeScale = 1., headlessDuration = 0.;
+    bool headless = false;
+    const char *explicitFile = nullptr, *tileDirectory = nullptr;
+    bool useRealTime = false, trackAllocations = false;
+    RealTimeProfile realTimeProfile;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--lockstep") == 0)
+            clockMode = ClockMode::LOCKSTEP;
+        else if (std::strcmp(argv[i], "--scale") == 0 && i+1 < argc)
+        {
+            clockMode = ClockMode::SCALED;
+            timeScale = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--headless") == 0 && i+1 < argc)
+        {
+            headless = true;
+            clockMode = ClockMode::LOCKSTEP;
+            headlessDuration = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--lqr") == 0)
+            useLQR = true;
+        else if (std::strcmp(argv[i], "--quaternion") == 0)
+            useQuaternion = true;
+        else if (std::strcmp(argv[i], "--ekf") == 0)
+            useEKF = true;
+        else if (std::strcmp(argv[i], "--actuators") == 0)
+            useActuators = true;
+        else if (std::strcmp(argv[i], "--event") == 0)
+            useEvents = true;
+        else if (std::strcmp(argv[i], "--cylinders") == 0)
+            useCylinders = true;
+        else if (std::strcmp(argv[i], "--tiles") == 0 && i+1 < argc)
+            tileDirectory = argv[++i];
+        else if (std::strcmp(argv[i], "--realtime") == 0 && i+1 < argc)
+        {
+            useRealTime = true;
+            realTimeProfile.cpu = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--track-allocations") == 0)
+            trackAllocations = true;
+        else
+            explicitFile = argv[i];
+    }
+    if (clockMode == ClockMode::SCALED && timeScale <= 0.)
+    {
+        cout << "usage: " << argv[0] << " --scale <factor>, the factor must be positive" << endl;
+        return 1;
+    }
+    // the event trigger only drives the plain MPC
+    if (useEvents && (useLQR || explicitFile))
+    {
+        cout << "--event cannot be combined with --lqr nor an explicit controller" << endl;
+        return 1;
+    }
 
     // SET UP THE MPC CONTROLLER:
     // --------------------------
-    RealTimeAlgorithm alg(ocp);
-    alg.set(INTEGRATOR_TYPE, INT_RK45);
-    alg.set(MAX_NUM_ITERATIONS,1);
-    alg.set(PRINT_COPYRIGHT, false);
-    alg.set(DISCRETIZATION_TYPE, SINGLE_SHOOTING);
-    Controller controller(alg);
+    // Horizon, weights, propeller bounds and obstacles are online parameters of the solver, see MPCParameters
+    MPCParameters parameters = useActuators ? MPCParameters::actuated() : MPCParameters();
+    if (useQuaternion)
+        parameters.attitude = AttitudeModel::QUATERNION;
+    if (useCylinders)
+        parameters.obstacleConstraints = ObstacleConstraints::CYLINDERS;
+    MPCSolver mpc(parameters);
+    EventTriggeredMPC triggeredMPC(mpc);
+
+    // Loading cylindrical obstacles from XML, a tiled environment gives them as the drone moves
+    EnvironmentPtr environment = Environment::create({});
+    std::unique_ptr<TiledEnvironment> tiles;
+    if (tileDirectory)
+    {
+        tiles.reset(new TiledEnvironment(tileDirectory));
+        if (!tiles->isOpen())
+        {
+            cout << "no tiled environment in " << tileDirectory << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        EnvironmentParser parser(PIE_SOURCE_DIR"/data/envsave.xml");
+        environment = parser.readEnvironment();
+    }
+    mpc.setObstacles(*environment);
+
+
+    // SET UP THE SIMULATED PROCESS:
+    // -----------------------------
+    DynamicSystem dynamicSystem(mpc.getModel(),OutputFcn{});
+    Process process(dynamicSystem,INT_RK45);
 
     // SETTING UP THE SIMULATION ENVIRONMENT:
     // --------------------------------------
-    DVector X(12), U(4), U0(4);
+    DVector X(mpc.getNbStates()), U(MPCSolver::NB_CONTROLS);
     X.setZero();
     X(2) = 4.;
-  //  X(12) = X(13) = X(14) = X(15) = 58.;
+    if (useQuaternion)
+        X(6) = 1.;
+    const unsigned int propellers = mpc.getNbDroneStates();
+    for (unsigned int i = propellers; i < mpc.getNbStates(); i++)
+        X(i) = DroneModel::hoverSpeed();
     U.setZero();
-    U0.setZero();
-    controller.init(0., X);
+    mpc.init(0., X);
     process.init(0., X, U);
 
 //    VariablesGrid graph;
@@ -176,88 +232,427 @@ int main()
     // END OF ACADO SOLVER SETUP
     // -------------------------
 
-    // Initialise input from keyboard
-    Input input(true);
-
-    // Gepetto viewer over corba
-    Viewer viewer;
-    viewer.createEnvironment(cylinders);
-    viewer.createDrone(PIE_SOURCE_DIR"/data/quadrotor_base.stl");
+    // Initialise input from keyboard, and the gepetto viewer over corba, unless headless
+    std::unique_ptr<Input> input;
+    std::unique_ptr<Viewer> viewer;
+    if (!headless)
+    {
+        input.reset(new Input(true));
+        viewer.reset(new Viewer);
+        viewer->createEnvironment(*environment);
+        viewer->createDrone(PIE_SOURCE_DIR"/data/quadrotor_base.stl");
+    }
 
+    // Reload the environment when the XML file changes
+    std::unique_ptr<EnvironmentWatcher> watcher;
+    if (!tiles)
+        watcher.reset(new EnvironmentWatcher(PIE_SOURCE_DIR"/data/envsave.xml", environment));
+    EnvironmentDelta delta;
+
+    // the MPC step is the step of the lockstep mode, with the LQR the inner loop runs in between
+    SimulationClock clock(clockMode, OUTER_PERIOD, timeScale);
+    bool lockstep = clockMode == ClockMode::LOCKSTEP;
+    auto wallStart = std::chrono::steady_clock::now();
+    auto lastTick = wallStart;
     double t = 0;
-    std::clock_t previousTime;
-    previousTime = std::clock();
-    auto refInput = input.getReference();
-    DVector LastRefVec(10);
-    LastRefVec.setZero();
+    double dt = 0;
+    auto refInput = input ? input->getReference() : HEADLESS_REFERENCE;
+
+    // Smoothed reference over the horizon, and its grid given to the solver, allocated once
+    ReferenceGenerator reference(parameters.nbIntervals, parameters.horizon);
+    const unsigned int nbReferencePoints = reference.getNbPoints();
+    VariablesGrid referenceVG(MPCSolver::NB_OUTPUTS, Grid{0., 1., nbReferencePoints});
+
+    // Explicit approximation of the MPC
+    ExplicitController explicitController;
+    bool useExplicit = explicitFile && explicitController.load(explicitFile);
+    double solveTime = 0.;
+
+    // the viewer takes roll-pitch-yaw, the angles psi, theta and phi of the model, composed in the order of the model
+    auto showDrone = [&]()
+    {
+        if (!viewer)
+            return;
+        if (useQuaternion)
+            viewer->moveDrone(X(0), X(1), X(2), X(6), X(7), X(8), X(9));
+        else
+            viewer->moveDrone(X(0), X(1), X(2), X(8), X(7), X(6));
+    };
+
+    // the startup ends with the first command given to the drone
+    bool started = false;
+    auto reportStartup = [&]()
+    {
+        if (started)
+            return;
+        started = true;
+        cout << "time to first control: "
+             << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupTime).count() << " ms" << endl;
+    };
+
+    // Publish the state in shared memory for the other processes (see state_monitor)
+    SharedStatePublisher statePublisher("/ProjectSupaero");
+    SharedStateRecord record = {};
+    int32_t solverStatus = SharedStateRecord::SOLVER_SKIPPED;
+    unsigned long nbSolves = 0, nbFailures = 0, nbViolations = 0;
+    unsigned long nbOverrides = 0, nbOutOfDomain = 0;          // Checks of the explicit controller by the MPC
+    DVector mpcU(MPCSolver::NB_CONTROLS);
+    double maxSlack = 0.;
+    // the slacks are counted once per solve, the published ones are repeated between the solves
+    auto countViolations = [&](bool success)
+    {
+        if (!success)
+            return;
+        double slack = std::max(mpc.getObstacleSlack(), mpc.getAttitudeSlack());
+        if (slack > SLACK_TOLERANCE)
+            nbViolations++;
+        maxSlack = std::max(maxSlack, slack);
+    };
+    auto publishState = [&](double time)
+    {
+        record.t = time;
+        record.nbStates = X.getDim();
+        record.solverStatus = solverStatus;
+        record.solveTime = solveTime;
+        record.nbSolves = nbSolves;
+        record.obstacleSlack = mpc.getObstacleSlack();
+        record.attitudeSlack = mpc.getAttitudeSlack();
+        record.trigger = static_cast<int32_t>(triggeredMPC.getLastTrigger());
+        for (unsigned int i = 0; i < X.getDim(); i++)
+            record.state[i] = X(i);
+        for (unsigned int i = 0; i < MPCSolver::NB_CONTROLS; i++)
+            record.controls[i] = U(i);
+        for (unsigned int i = 0; i < 3; i++)
+            record.reference[i] = refInput[i];
+        statePublisher.publish(record);
+    };
+
+    // the LQR and the explicit controller give propeller velocities, the actuator model follows them at its rate limit
+    auto commandPropellers = [&](const double *u)
+    {
+        for (unsigned int i = 0; i < MPCSolver::NB_CONTROLS; i++)
+        {
+            double velocity = std::min(std::max(u[i], parameters.uMin), parameters.uMax);
+            if (useActuators)
+                U(i) = std::min(std::max((velocity - X(propellers+i))/PROPELLER_TIME_CONSTANT, -parameters.vuMax), parameters.vuMax);
+            else
+                U(i) = velocity;
+        }
+    };
+
+    // Simulated sensors, and the estimator running on its own thread
+    SensorModel sensors;
+    StateEstimator estimator(sensors.getParameters());
+    SensorSamples samples;
+    samples.reserve(64);
+    DroneModel::State xMeasured = eulerState(X, useQuaternion), xEstimated;
+    estimator.init(0., xMeasured);
+    DVector Xc = X;
+
+    // the sensors measure the simulated drone between two steps
+    auto measure = [&](double t0, double t1)
+    {
+        if (!useEKF)
+            return;
+        DroneModel::State x1 = eulerState(X, useQuaternion);
+        DroneModel::Command u;
+        for (unsigned int i = 0; i < MPCSolver::NB_CONTROLS; i++)
+            u(i) = useActuators ? X(propellers+i) : U(i);
+        sensors.update(t0, xMeasured, t1, x1, u, samples);
+        estimator.push(samples);
+        xMeasured = x1;
+        // in lockstep, the controller sees the estimate of every sample whatever the speed of the filter thread
+        if (lockstep)
+            estimator.waitIdle();
+    };
+
+    // state given to the controllers, the simulated one or the last estimate
+    auto controlledState = [&]() -> const DVector &
+    {
+        if (!useEKF)
+            return X;
+        estimator.getEstimate(xEstimated);
+        if (useQuaternion)
+        {
+            DroneModel::QuaternionState x = DroneModel::toQuaternionState(xEstimated);
+            for (unsigned int i = 0; i < MPCSolver::NB_STATES_QUATERNION; i++)
+                Xc(i) = x(i);
+        }
+        else
+            for (unsigned int i = 0; i < MPCSolver::NB_STATES; i++)
+                Xc(i) = xEstimated(i);
+        // the propeller velocities are measured
+        for (unsigned int i = propellers; i < X.getDim(); i++)
+            Xc(i) = X(i);
+        return Xc;
+    };
+
+    HoverLQR lqr(INNER_PERIOD);
+    TwoRateScheduler scheduler(INNER_PERIOD, OUTER_PERIOD);
+    DroneModel::State xRef, xLQR;
+    DroneModel::Command uRef, uLQR;
+    xRef.setZero();
+    uRef.setConstant(DroneModel::hoverSpeed());
+
+    // the outer loop solves the MPC from the current state, the inner loop tracks the prediction of the model under
+    // the MPC command
+    auto outerStep = [&](double tick)
+    {
+        const DVector &Xm = controlledState();
+        xRef = eulerState(Xm, useQuaternion);
+        std::clock_t solveStart = std::clock();
+        bool success = mpc.step(tick, Xm);
+        nbSolves++;
+        countViolations(success);
+        solveTime = (double)(std::clock() - solveStart) / (double)CLOCKS_PER_SEC;
+        solverStatus = success ? SharedStateRecord::SOLVER_SUCCEEDED : SharedStateRecord::SOLVER_FAILED;
+        nbFailures += !success;
+        if (success)
+        {
+            mpc.getU(U);
+            // with the actuator model, the reference is the velocity reached at the end of the outer period
+            for (unsigned int i = 0; i < MPCSolver::NB_CONTROLS; i++)
+                uRef(i) = useActuators ? Xm(propellers+i) + U(i)*OUTER_PERIOD : U(i);
+        }
+        else
+            std::cout << "controller failed " << std::endl;
+    };
+    auto innerStep = [&](double tick)
+    {
+        xLQR = eulerState(controlledState(), useQuaternion);
+        uLQR = lqr.control(xLQR, xRef, uRef);
+        commandPropellers(uLQR.data());
+        reportStartup();
+        process.step(tick, tick+INNER_PERIOD, U);
+        process.getY(Y);
+        X = Y.getLastVector();
+        measure(tick, tick+INNER_PERIOD);
+        xRef = DroneModel::integrate(xRef, uRef, INNER_PERIOD);
+        publishState(tick+INNER_PERIOD);
+    };
+
+    // the helper threads are running, the profile only applies to the thread of the loop
+    if (useRealTime && !RealTime::apply(realTimeProfile))
+        cout << "the real-time profile is incomplete" << endl;
+
+    // the allocations of an iteration are checked at the start of the next one, so that every path of the loop is covered
+    unsigned long nbIterations = 0, nbAllocatingIterations = 0, nbAllocations = 0, maxAllocations = 0;
+    auto checkAllocations = [&]()
+    {
+        if (!trackAllocations || nbIterations++ < ALLOCATION_WARMUP)
+            return;
+        unsigned long count = AllocationTracker::stop();
+        if (nbIterations > ALLOCATION_WARMUP+1 && count > 0)
+        {
+            nbAllocatingIterations++;
+            nbAllocations += count;
+            maxAllocations = std::max(maxAllocations, count);
+            if (nbAllocatingIterations <= ALLOCATION_REPORTS)
+            {
+                cout << "iteration " << nbIterations-1 << " at t = " << t << ": " << count << " allocations, "
+                     << AllocationTracker::getBytes() << " bytes" << endl;
+                AllocationTracker::report(STDOUT_FILENO);
+            }
+        }
+        AllocationTracker::start();
+    };
 
-    while(true)
+    while(!headless || t < headlessDuration)
     {
+        checkAllocations();
+
+        // apply the changes of the environment file, or of the tiles around the drone
+        bool changed = tiles ? tiles->pollDelta(X(0), X(1), X(3), X(4), delta) : watcher->pollDelta(delta);
+        if (changed)
+        {
+            if (viewer)
+            {
+                viewer->removeObstacles(delta.removed);
+                viewer->addObstacles(delta.added);
+            }
+            mpc.removeObstacles(delta.removed);
+            mpc.addObstacles(delta.added);
+            triggeredMPC.invalidate();
+        }
+
+        // P pauses the simulation, S advances it by one step while paused
+        if (input)
+        {
+            if (input->pausePressed())
+                clock.setPaused(!clock.isPaused());
+            if (input->stepPressed())
+                clock.stepOnce();
+        }
+        if (!clock.isRunning())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
         // getting reference from input and passing it to the algorithm
-        refInput = input.getReference();
-if (abs(refInput[0]-LastRefVec(0))>1.)
-{
-if (refInput[0]>LastRefVec(0)) { refInput[0] = LastRefVec(0)+1.;}
-else {refInput[0] = LastRefVec(0)-1.;}
-}
-if (abs(refInput[1]-LastRefVec(1))>1.)
-{
-if (refInput[1]>LastRefVec(1)) { refInput[1] = LastRefVec(1)+1.;}
-else {refInput[1] = LastRefVec(1)-1.;}
-}
-if (abs(refInput[0]-LastRefVec(0))>1.)
-{
-if (refInput[2]>LastRefVec(2)) { refInput[2] = LastRefVec(2)+1.;}
-else {refInput[2] = LastRefVec(2)-1.;}
-}
-        double refT[10] = {refInput[0], refInput[1], refInput[2], 0., 0., 0., 0., 0., 0., 0.};
-        DVector refVec(10, refT);
-        VariablesGrid referenceVG (refVec, Grid{t, t+1., 2});
-        referenceVG.setVector(0, LastRefVec);
-        alg.setReference(referenceVG);
-        LastRefVec = refVec;
+        if (input)
+            refInput = input->getReference();
+        reference.update(dt, {refInput[0], refInput[1], refInput[2]});
+        for (unsigned int i = 0; i < nbReferencePoints; i++)
+        {
+            referenceVG.setTime(i, t + i/(nbReferencePoints-1.));
+            for (unsigned int j = 0; j < MPCSolver::NB_OUTPUTS; j++)
+                referenceVG(i, j) = reference.getPoint(i)[j];
+        }
+        mpc.setReference(referenceVG);
 
         // get state vector
         process.getY(Y);
         X = Y.getLastVector();
 
-        // move the drone and draw the arrow
-        // viewer takes roll-pitch-yaw but drone equations are in yaw-pitch-roll
-        viewer.moveDrone(X(0), X(1), X(2), X(8), X(7), X(6));
-        //viewer.setArrow((refInput[0]>0) - (refInput[0]<0), (refInput[1]>0) - (refInput[1]<0), (refInput[2]>0) - (refInput[2]<0));
-        viewer.setArrow(refInput[0], refInput[1], refInput[2]);
+        // move the obstacles, the drone and draw the arrow
+        if (viewer)
+        {
+            viewer->updateObstacles(t);
+            showDrone();
+            //viewer->setArrow((refInput[0]>0) - (refInput[0]<0), (refInput[1]>0) - (refInput[1]<0), (refInput[2]>0) - (refInput[2]<0));
+            viewer->setArrow(refInput[0], refInput[1], refInput[2]);
+        }
 
         // MPC step
         // compute the command
-        bool success = controller.step(t, X);
+        if (useLQR)
+        {
+            // run the ticks of both loops due over the elapsed time, the process is simulated by the inner loop
+            dt = clock.tick();
+            t += dt;
+            scheduler.advance(t, innerStep, outerStep);
 
-        if (success != 0)
+            showDrone();
+            continue;
+        }
+        else if (useExplicit)
+        {
+            // the explicit controller drives the drone. The MPC checks its command when there is time to run it, and
+            // always when the state leaves the training domain of the network: its command is only used when they disagree.
+            std::array<double,12> state;
+            DroneModel::State x = eulerState(controlledState(), useQuaternion);
+            for (unsigned int i = 0; i < MPCSolver::NB_STATES; i++)
+                state[i] = x(i);
+            std::array<double,3> speed = {reference.getPoint(0)[0], reference.getPoint(0)[1], reference.getPoint(0)[2]};
+            auto u = explicitController.evaluate(state, speed);
+            commandPropellers(u.data());
+            bool inDomain = explicitController.inDomain(state, speed);
+            nbOutOfDomain += !inDomain;
+
+            // in lockstep, the time of the solver does not count
+            if (lockstep || solveTime < EXPLICIT_BUDGET || !inDomain)
+            {
+                std::clock_t solveStart = std::clock();
+                bool success = mpc.step(t, controlledState());
+                nbSolves++;
+                countViolations(success);
+                if (success)
+                {
+                    // with the actuator model the commands are accelerations, compared through the velocity they
+                    // change in one time constant of the propellers
+                    mpc.getU(mpcU);
+                    double scale = useActuators ? PROPELLER_TIME_CONSTANT : 1., disagreement = 0.;
+                    for (unsigned int i = 0; i < MPCSolver::NB_CONTROLS; i++)
+                        disagreement = std::max(disagreement, std::abs(mpcU(i) - U(i))*scale);
+                    if (!inDomain || disagreement > EXPLICIT_TOLERANCE)
+                    {
+                        U = mpcU;
+                        nbOverrides++;
+                    }
+                }
+                solveTime = (double)(std::clock() - solveStart) / (double)CLOCKS_PER_SEC;
+                solverStatus = success ? SharedStateRecord::SOLVER_SUCCEEDED : SharedStateRecord::SOLVER_FAILED;
+                nbFailures += !success;
+            }
+            else
+            {
+                solveTime *= .9;
+                solverStatus = SharedStateRecord::SOLVER_SKIPPED;
+            }
+        }
+        else
         {
-std::cout << "controller failed " << std::endl;
-          return 1;          
+            std::clock_t solveStart = std::clock();
+            bool success = useEvents ? triggeredMPC.step(t, controlledState()) : mpc.step(t, controlledState());
+            solveTime = (double)(std::clock() - solveStart) / (double)CLOCKS_PER_SEC;
+            solverStatus = success ? SharedStateRecord::SOLVER_SUCCEEDED : SharedStateRecord::SOLVER_FAILED;
+            nbFailures += !success;
+            if (useEvents && triggeredMPC.getLastTrigger() == Trigger::NONE)
+                solverStatus = SharedStateRecord::SOLVER_PLAYED_BACK;
+            else
+            {
+                nbSolves++;
+                countViolations(success);
+            }
+
+            // the constraints are soft, a failure is numerical: the last command is kept
+            if (!success)
+                std::cout << "controller failed " << std::endl;
+            else if (useEvents)
+                triggeredMPC.getU(U);
+            else
+                mpc.getU(U);
         }
-        controller.getU(U);
 
-        // simulate the drone
-        std::clock_t currentTime = std::clock();
-        double dt = (double)(currentTime - previousTime) / (double)CLOCKS_PER_SEC;
+        // simulate the drone. A played back step costs nothing, the loop waits for the next control period instead of
+        // spinning on the wall clock
+        reportStartup();
+        if (solverStatus == SharedStateRecord::SOLVER_PLAYED_BACK && clockMode != ClockMode::LOCKSTEP)
+            std::this_thread::sleep_until(lastTick + std::chrono::duration<double>(OUTER_PERIOD/timeScale));
+        dt = clock.tick();
+        lastTick = std::chrono::steady_clock::now();
         process.step(t,t+dt,U);
         t += dt;
 
         // get the new state vector
         process.getY(Y);
         X = Y.getLastVector();
+        measure(t-dt, t);
 
-        // move the drone to it's new position
-        // viewer takes roll-pitch-yaw but drone equations are in yaw-pitch-roll
-        viewer.moveDrone(X(0), X(1), X(2), X(8), X(7), X(6));
+        publishState(t);
 
-        previousTime = currentTime;
+        // move the drone to it's new position
+        showDrone();
 
 //        graph.addVector(X,t);
     }
+    AllocationTracker::stop();
 
 
+    // the final state is printed in full, so that two headless runs can be compared
+    double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    cout << "simulated " << t << " s in " << wallTime << " s, " << nbSolves << " MPC solves, " << nbFailures << " failed" << endl;
+    cout << "soft constraints violated at " << nbViolations << " of " << nbSolves << " MPC solves, largest slack " << maxSlack << endl;
+    if (useExplicit)
+        cout << "explicit controller overridden by the MPC at " << nbOverrides << " steps, out of its domain at "
+             << nbOutOfDomain << " steps" << endl;
+    if (useEvents)
+    {
+        const char *reasons[] = {"played back", "start", "deviation", "reference", "obstacle", "expired", "failed"};
+        const TriggerStatistics &statistics = triggeredMPC.getStatistics();
+        for (unsigned int i = 0; i < TriggerStatistics::NB_TRIGGERS; i++)
+            cout << "  " << reasons[i] << ": " << statistics.triggers[i] << " of " << statistics.nbSteps << " steps" << endl;
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        double cpuTime = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)*1e-6;
+        cout << "  process CPU time " << cpuTime << " s for " << wallTime << " s of wall clock" << endl;
+    }
+    if (trackAllocations)
+        cout << "allocations in steady state: " << nbAllocatingIterations << " of " << nbIterations - std::min(nbIterations, ALLOCATION_WARMUP+1)
+             << " iterations, " << nbAllocations << " in total, at most " << maxAllocations << " per iteration" << endl;
+    if (tiles)
+    {
+        TileStatistics statistics = tiles->getStatistics();
+        cout << "tiles: " << statistics.hits << " hits, " << statistics.misses << " misses, " << statistics.prefetched
+             << " prefetched, " << statistics.evicted << " evicted, load time " << statistics.meanLoadTime*1000.
+             << " ms (max " << statistics.maxLoadTime*1000. << " ms)" << endl;
+    }
+    cout << std::setprecision(17) << "final state:";
+    for (unsigned int i = 0; i < X.getDim(); i++)
+        cout << " " << X(i);
+    cout << endl;
+
     // draw every variable into a graph. Useful for debug
 //    GnuplotWindow window;
 //    window.addSubplot(graph(0), "x");
@@ -0,0 +1,95 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Measures the startup of a swarm in the viewer: decimation of the drone mesh with and without the cache, then the
+// creation of the drones by loading the decimated mesh for each of them, or by instancing it once loaded, both from a
+// cold cache. Needs a running gepetto server.
+//   benchmark_drone_startup [number of drones]
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "viewer.h"
+#include "stlmesh.h"
+
+using std::cout; using std::endl;
+
+const char *DRONE_MESH = PIE_SOURCE_DIR"/data/quadrotor_base.stl";
+const float DECIMATION = 0.02f;
+
+double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int nbDrones = argc > 1 ? std::atoi(argv[1]) : 32;
+
+    // decimation, first without the cache
+    StlMesh mesh;
+    mesh.load(DRONE_MESH);
+    unsigned int nbTriangles = mesh.getNbTriangles();
+
+    std::string cache = StlMesh::cached(DRONE_MESH, DECIMATION);
+    std::remove(cache.c_str());
+    auto start = std::chrono::steady_clock::now();
+    StlMesh::cached(DRONE_MESH, DECIMATION);
+    double cold = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+    StlMesh::cached(DRONE_MESH, DECIMATION);
+    double warm = elapsed(start);
+
+    mesh.load(cache);
+    cout << "mesh: " << nbTriangles << " triangles, " << mesh.getNbTriangles() << " after decimation" << endl;
+    cout << "decimation: " << cold << " ms, from the cache: " << warm << " ms" << endl;
+
+    // one mesh loaded per drone, and one mesh instanced by every drone, both decimating the same mesh from a cold cache
+    Viewer viewer;
+    ClientCpp client;
+    std::remove(cache.c_str());
+    start = std::chrono::steady_clock::now();
+    std::string decimated = StlMesh::cached(DRONE_MESH, DECIMATION);
+    for (unsigned int i = 0; i < nbDrones; i++)
+    {
+        std::string name = "/world/loaded" + std::to_string(i);
+        client.addMesh(name.c_str(), decimated.c_str());
+    }
+    double loaded = elapsed(start);
+
+    viewer.createEnvironment(*Environment::create({}));
+    std::remove(cache.c_str());
+    start = std::chrono::steady_clock::now();
+    viewer.createDrone(DRONE_MESH, DECIMATION);
+    for (unsigned int i = 1; i < nbDrones; i++)
+        viewer.addDrone("drone" + std::to_string(i));
+    double instanced = elapsed(start);
+
+    cout << nbDrones << " drones, one mesh each: " << loaded << " ms, instanced: " << instanced << " ms" << endl;
+
+    return 0;
+}
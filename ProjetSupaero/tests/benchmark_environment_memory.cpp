@@ -0,0 +1,184 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Measures the memory held by the cylinders of a large environment once loaded by the subsystems of ProjectSupaero, with
+// a copy per subsystem as before the shared Environment, and with the shared Environment:
+//   benchmark_environment_memory [number of cylinders, 200000 by default]
+// Each layout is measured in its own process, from the resident memory before and after loading, once the parser is
+// released and the freed heap returned to the system.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <map>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "environment.h"
+
+using std::cout; using std::endl;
+
+const char *FILE_NAME = "/tmp/benchmark_environment_memory.xml";
+
+/**
+ * @brief residentMemory Resident memory of the process, in bytes
+ */
+long residentMemory()
+{
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr)
+        return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    fclose(statm);
+    return resident*sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief copies Load the environment as before: the main loop keeps its vector, and the solver, the viewer and the
+ * watcher their own copies of the cylinders. The parser and its document are released, as in shared.
+ * @return the resident memory once loaded
+ */
+long copies()
+{
+    // the viewer kept the configuration and the scale of each cylinder
+    struct CylinderNode
+    {
+        Ecylinder cylinder;
+        float pose[12];
+        float scale[3];
+        int slot;
+    };
+
+    std::vector<Ecylinder> cylinders;
+    {
+        EnvironmentParser parser(FILE_NAME);
+        cylinders = parser.readData();
+    }
+    std::vector<Ecylinder> solver = cylinders;
+    std::map<unsigned int, CylinderNode> viewer;
+    std::map<unsigned int, Ecylinder> applied, latest;
+    for (const Ecylinder &c : cylinders)
+    {
+        viewer[c.id].cylinder = c;
+        applied[c.id] = c;
+    }
+    latest = applied;
+    malloc_trim(0);
+    return residentMemory();
+}
+
+/**
+ * @brief shared Load the environment once and give its obstacles to the solver, the viewer and the watcher
+ * @return the resident memory once loaded
+ */
+long shared()
+{
+    struct CylinderNode
+    {
+        ObstaclePtr obstacle;
+        int slot;
+    };
+
+    EnvironmentPtr environment;
+    {
+        EnvironmentParser parser(FILE_NAME);
+        environment = parser.readEnvironment();
+    }
+    std::vector<ObstaclePtr> solver = environment->getObstacles();
+    std::map<unsigned int, CylinderNode> viewer;
+    for (const ObstaclePtr &o : environment->getObstacles())
+        viewer[o->cylinder.id].obstacle = o;
+    EnvironmentPtr applied = environment, latest = environment;
+    malloc_trim(0);
+    return residentMemory();
+}
+
+/**
+ * @brief measure Run a layout in a child process and get the memory it added
+ */
+long measure(long (*layout)())
+{
+    int fd[2];
+    if (pipe(fd) != 0)
+        return -1;
+
+    if (fork() == 0)
+    {
+        long before = residentMemory();
+        long added = layout() - before;
+        if (write(fd[1], &added, sizeof(added)) != sizeof(added))
+            _exit(1);
+        _exit(0);
+    }
+
+    long added = -1;
+    close(fd[1]);
+    if (read(fd[0], &added, sizeof(added)) != sizeof(added))
+        added = -1;
+    close(fd[0]);
+    wait(nullptr);
+    return added;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned int count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+
+    // a forest of static poles, a tenth of them moving along keyframes
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-1000.f, 1000.f), radius(.2f, .6f), height(5.f, 15.f);
+    std::vector<Ecylinder> cylinders(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Ecylinder &c = cylinders[i];
+        c.id = i+1;
+        c.x1 = c.x2 = position(rng);
+        c.y1 = c.y2 = position(rng);
+        c.z1 = 0.f;
+        c.z2 = height(rng);
+        c.radius = radius(rng);
+        c.vx = c.vy = c.vz = 0.f;
+        if (i % 10 == 0)
+            c.keyframes = {{0.f, 0.f, 0.f, 0.f}, {5.f, 3.f, 0.f, 0.f}, {10.f, 0.f, 0.f, 0.f}};
+    }
+    if (!EnvironmentParser::write(FILE_NAME, cylinders))
+        return 1;
+
+    EnvironmentPtr environment = Environment::create(cylinders);
+    long before = measure(copies), after = measure(shared);
+    remove(FILE_NAME);
+
+    cout << count << " cylinders, environment of " << environment->memoryUsage()/1e6 << " MB" << endl;
+    cout << std::fixed << std::setprecision(1);
+    cout << "copy per subsystem: " << before/1e6 << " MB" << endl;
+    cout << "shared environment: " << after/1e6 << " MB" << endl;
+    return 0;
+}
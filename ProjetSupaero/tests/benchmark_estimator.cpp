@@ -0,0 +1,170 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Measures the cost of the state estimator: duration of the prediction and of the correction of the filter, then
+// the same flight in the environment of data/envsave.xml with the MPC fed the simulated state or the estimate of the
+// filter running on its own thread.
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+#include <acado_toolkit.hpp>
+#include <acado_optimal_control.hpp>
+
+#include "environment.h"
+#include "mpcsolver.h"
+#include "sensormodel.h"
+#include "stateestimator.h"
+
+using std::cout; using std::endl;
+
+const double DT = 0.02;                 // Simulation step
+const unsigned int NB_STEPS = 250;      // Number of MPC steps of a flight
+const unsigned int NB_UPDATES = 100000; // Number of updates timed for the filter alone
+
+double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+DroneModel::State toState(const ACADO::DVector &X)
+{
+    DroneModel::State x;
+    for (unsigned int i = 0; i < MPCSolver::NB_STATES; i++)
+        x(i) = X(i);
+    return x;
+}
+
+int main()
+{
+    USING_NAMESPACE_ACADO;
+
+    // FILTER ALONE:
+    // -------------
+    SensorParameters sensorParameters;
+    SensorModel sensors(sensorParameters);
+    Ekf ekf(sensorParameters);
+    DroneModel::State x = DroneModel::State::Zero();
+    x(2) = 4.;
+    ekf.init(0., x);
+
+    SensorSamples samples;
+    samples.reserve(NB_UPDATES);
+    DroneModel::Command hover = DroneModel::Command::Constant(DroneModel::hoverSpeed());
+    sensors.update(0., x, NB_UPDATES/sensorParameters.imuRate, x, hover, samples);
+
+    double predictTime = 0., correctTime = 0.;
+    unsigned int nbPredict = 0, nbCorrect = 0;
+    for (const SensorSample &sample : samples)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (sample.type == SensorSample::IMU)
+        {
+            ekf.predict(sample);
+            predictTime += elapsed(start);
+            nbPredict++;
+        }
+        else
+        {
+            ekf.correct(sample);
+            correctTime += elapsed(start);
+            nbCorrect++;
+        }
+    }
+    cout << "prediction: " << predictTime/nbPredict*1e6 << " us, correction: " << correctTime/nbCorrect*1e6 << " us" << endl;
+
+    // CLOSED LOOP:
+    // ------------
+    EnvironmentParser parser(PIE_SOURCE_DIR"/data/envsave.xml");
+    EnvironmentPtr environment = parser.readEnvironment();
+
+    cout << "state       step (ms)  max step (ms)  position error (m)  estimator updates  mean update (us)  dropped" << endl;
+    for (bool useEKF : {false, true})
+    {
+        MPCSolver mpc;
+        mpc.setObstacles(*environment);
+        DynamicSystem dynamicSystem(mpc.getModel(),OutputFcn{});
+        Process process(dynamicSystem,INT_RK45);
+
+        DVector X(MPCSolver::NB_STATES), Xc(MPCSolver::NB_STATES), U(MPCSolver::NB_CONTROLS);
+        X.setZero();
+        X(2) = 4.;
+        U.setZero();
+        mpc.init(0., X);
+        process.init(0., X, U);
+
+        SensorModel loopSensors(sensorParameters);
+        StateEstimator estimator(sensorParameters);
+        estimator.init(0., toState(X));
+
+        // fly forward at 1 m/s
+        DVector refVec(MPCSolver::NB_OUTPUTS);
+        refVec.setZero();
+        refVec(1) = 1.;
+
+        VariablesGrid Y;
+        DroneModel::State xEstimated;
+        double t = 0., total = 0., worst = 0., error = 0.;
+        for (unsigned int i = 0; i < NB_STEPS; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            Xc = X;
+            if (useEKF)
+            {
+                estimator.getEstimate(xEstimated);
+                for (unsigned int j = 0; j < MPCSolver::NB_STATES; j++)
+                    Xc(j) = xEstimated(j);
+                error += (xEstimated.head<3>() - toState(X).head<3>()).squaredNorm();
+            }
+
+            mpc.setReference(VariablesGrid(refVec, Grid{t, t+1., 2}));
+            if (mpc.step(t, Xc))
+                mpc.getU(U);
+            double step = elapsed(start)*1e3;
+            total += step;
+            worst = std::max(worst, step);
+
+            DroneModel::State x0 = toState(X);
+            process.step(t, t+DT, U);
+            process.getY(Y);
+            X = Y.getLastVector();
+
+            if (useEKF)
+            {
+                DroneModel::Command u;
+                for (unsigned int j = 0; j < MPCSolver::NB_CONTROLS; j++)
+                    u(j) = U(j);
+                loopSensors.update(t, x0, t+DT, toState(X), u, samples);
+                estimator.push(samples);
+            }
+            t += DT;
+        }
+
+        cout << (useEKF ? "estimated " : "simulated ") << "  " << total/NB_STEPS << "\t   " << worst << "\t\t  "
+             << std::sqrt(error/NB_STEPS) << "\t\t      " << estimator.getNbUpdates() << "\t\t " << estimator.getMeanUpdateTime()*1e6
+             << "\t\t   " << estimator.getNbDropped() << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+// Measures the time of an MPC step against the number of intervals of the horizon, for single and multiple shooting,
+// with the 12 states model and with the 16 states model which includes the propeller velocities, and with the
+// cylindrical or the corridor constraints of the obstacles.
+// Each configuration flies the drone forward for a few seconds in the environment of data/envsave.xml.
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <acado_toolkit.hpp>
+#include <acado_optimal_control.hpp>
+
+#include "environment.h"
+#include "mpcsolver.h"
+#include "dronemodel.h"
+
+using std::cout; using std::endl;
+
+const double DT = 0.02;                 // Simulation step
+const unsigned int NB_STEPS = 100;      // Number of MPC steps per configuration
+const double INTERVAL_LENGTH = 0.1;     // Length of an interval, the horizon grows with the number of intervals
+
+
+int main()
+{
+    USING_NAMESPACE_ACADO;
+
+    EnvironmentParser parser(PIE_SOURCE_DIR"/data/envsave.xml");
+    EnvironmentPtr environment = parser.readEnvironment();
+
+    cout << "obstacles  states  intervals  discretization     setup (s)  mean (ms)  max (ms)  failures" << endl;
+
+    for (ObstacleConstraints obstacleConstraints : {ObstacleConstraints::CYLINDERS, ObstacleConstraints::CORRIDOR})
+    {
+        for (bool actuatorDynamics : {false, true})
+        {
+            for (int discretization : {SINGLE_SHOOTING, MULTIPLE_SHOOTING})
+            {
+                for (int nbIntervals : {4, 8, 16, 32})
+                {
+                    auto setupStart = std::chrono::steady_clock::now();
+
+                    // the multiple shooting runs start from the long horizon tuning; ACADO condenses the QP in both cases
+                    MPCParameters parameters = discretization == MULTIPLE_SHOOTING ? MPCParameters::longHorizon() : MPCParameters();
+                    parameters.actuatorDynamics = actuatorDynamics;
+                    parameters.obstacleConstraints = obstacleConstraints;
+                    parameters.nbIntervals = nbIntervals;
+                    parameters.horizon = nbIntervals*INTERVAL_LENGTH;
+                    MPCSolver mpc(parameters);
+                    mpc.setObstacles(*environment);
+
+                    DynamicSystem dynamicSystem(mpc.getModel(),OutputFcn{});
+                    Process process(dynamicSystem,INT_RK45);
+
+                    DVector X(mpc.getNbStates()), U(MPCSolver::NB_CONTROLS);
+                    X.setZero();
+                    X(2) = 4.;
+                    for (unsigned int i = mpc.getNbDroneStates(); i < mpc.getNbStates(); i++)
+                        X(i) = DroneModel::hoverSpeed();
+                    U.setZero();
+                    mpc.init(0., X);
+                    process.init(0., X, U);
+
+                    // fly forward at 1 m/s
+                    DVector refVec(MPCSolver::NB_OUTPUTS);
+                    refVec.setZero();
+                    refVec(1) = 1.;
+
+                    double setup = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+
+                    VariablesGrid Y;
+                    double t = 0., total = 0., worst = 0.;
+                    unsigned int failures = 0;
+                    for (unsigned int i = 0; i < NB_STEPS; i++)
+                    {
+                        mpc.setReference(VariablesGrid(refVec, Grid{t, t+1., 2}));
+
+                        auto start = std::chrono::steady_clock::now();
+                        bool success = mpc.step(t, X);
+                        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                        total += elapsed;
+                        worst = std::max(worst, elapsed);
+                        if (!success)
+                        {
+                            failures++;
+                            continue;
+                        }
+
+                        mpc.getU(U);
+                        process.step(t, t+DT, U);
+                        t += DT;
+                        process.getY(Y);
+                        X = Y.getLastVector();
+                    }
+
+                    cout << (obstacleConstraints == ObstacleConstraints::CORRIDOR ? "corridor   " : "cylinders  ")
+                         << mpc.getNbStates() << "\t" << nbIntervals << "\t   "
+                         << (discretization == SINGLE_SHOOTING ? "single shooting  " : "multiple shooting") << "  "
+                         << setup << "\t   " << total/NB_STEPS << "\t" << worst << "\t  " << failures << endl;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Measures the time to the first command of a new MPC solver, when its problem is built and when it is copied from a
+// solver built before with the same structure. Each configuration creates a few solvers in a row, as a batch of
+// scenarios would, and each solver is initialised and stepped once in the environment of data/envsave.xml.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+#include <acado_toolkit.hpp>
+#include <acado_optimal_control.hpp>
+
+#include "environment.h"
+#include "mpcsolver.h"
+#include "dronemodel.h"
+
+using std::cout; using std::endl;
+
+const unsigned int NB_SOLVERS = 5;      // Number of solvers created per configuration
+
+typedef std::chrono::steady_clock Clock;
+
+double milliseconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+int main()
+{
+    USING_NAMESPACE_ACADO;
+
+    EnvironmentParser parser(PIE_SOURCE_DIR"/data/envsave.xml");
+    EnvironmentPtr environment = parser.readEnvironment();
+
+    const char *names[] = {"default", "long horizon", "actuated"};
+    MPCParameters configurations[] = {MPCParameters(), MPCParameters::longHorizon(), MPCParameters::actuated()};
+
+    cout << "configuration  solver  setup (ms)  first step (ms)  first control (ms)" << endl;
+
+    for (unsigned int c = 0; c < 3; c++)
+    {
+        for (unsigned int n = 0; n < NB_SOLVERS; n++)
+        {
+            Clock::time_point start = Clock::now();
+            MPCSolver mpc(configurations[c]);
+            mpc.setObstacles(*environment);
+            Clock::time_point built = Clock::now();
+
+            DVector X(mpc.getNbStates()), U(MPCSolver::NB_CONTROLS);
+            X.setZero();
+            X(2) = 4.;
+            for (unsigned int i = mpc.getNbDroneStates(); i < mpc.getNbStates(); i++)
+                X(i) = DroneModel::hoverSpeed();
+            DVector refVec(MPCSolver::NB_OUTPUTS);
+            refVec.setZero();
+            refVec(1) = 1.;
+            mpc.setReference(VariablesGrid(refVec, Grid{0., 1., 2}));
+
+            Clock::time_point stepStart = Clock::now();
+            mpc.init(0., X);
+            bool success = mpc.step(0., X);
+            mpc.getU(U);
+            Clock::time_point end = Clock::now();
+
+            cout << std::left << std::setw(15) << names[c] << n << (n == 0 ? " built " : " copied")
+                 << "  " << milliseconds(start, built) << "\t" << milliseconds(stepStart, end)
+                 << "\t\t " << milliseconds(start, end) << (success ? "" : "  (failed)") << endl;
+        }
+    }
+
+    return 0;
+}
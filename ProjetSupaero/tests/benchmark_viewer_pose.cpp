@@ -0,0 +1,169 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Measures the cost of the pose computations of the viewer for 10k cylinders, without the gepetto server: the former
+// computation with rotation matrices built at each frame, against the orientations cached at creation.
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "environmentparser.h"
+#include "posemath.h"
+
+using std::cout; using std::endl;
+using namespace Eigen;
+
+const unsigned int NB_OBJECTS = 10000;
+const unsigned int NB_FRAMES = 100;
+const double FRAME_PERIOD = 0.05;
+
+struct Pose
+{
+    Matrix3f rotation;
+    Vector3f translation;
+};
+
+// Former Viewer::rotationMat, Y being rotated the other way round
+Matrix3d rotationMat(double angle, int axis)
+{
+    Matrix3d mat(3,3);
+    double c = cos(angle), s = sin(angle);
+    if (axis == 0)
+        mat << 1., 0., 0., 0., c, -s, 0., s, c;
+    else if (axis == 1)
+        mat << c, 0., -s, 0., 1., 0., s, 0., c;
+    else
+        mat << c, -s, 0., s, c, 0., 0., 0., 1.;
+    return mat;
+}
+
+// Former Viewer::cylinderPosition
+Pose legacyPose(const Ecylinder &cyl, double t)
+{
+    Pose pose;
+    Epoint o = cyl.displacement(t);
+    pose.translation = Vector3f((cyl.x1+cyl.x2)/2.f + o.x, (cyl.y1+cyl.y2)/2.f + o.y, (cyl.z1+cyl.z2)/2.f + o.z);
+
+    float dx = cyl.x2-cyl.x1;
+    float dy = cyl.y2-cyl.y1;
+    float dz = cyl.z2-cyl.z1;
+    double theta = atan2(dy,dx);
+    double phi = -atan2(sqrt(pow(dx,2)+pow(dy,2)),dz);
+    pose.rotation = rotationMat(theta, 2).cast<float>()*rotationMat(phi, 1).cast<float>();
+    return pose;
+}
+
+double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    // random cylinders, half of them moving
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> position(-100.f, 100.f), direction(-1.f, 1.f);
+    std::vector<Ecylinder> cylinders(NB_OBJECTS);
+    for (unsigned int i = 0; i < NB_OBJECTS; i++)
+    {
+        Ecylinder &c = cylinders[i];
+        c.id = i+1;
+        c.x1 = position(rng); c.y1 = position(rng); c.z1 = position(rng);
+        c.x2 = c.x1 + 10.f*direction(rng); c.y2 = c.y1 + 10.f*direction(rng); c.z2 = c.z1 + 10.f*direction(rng);
+        c.radius = 1.f;
+        c.vx = c.vy = c.vz = 0.f;
+        if (i%2)
+            c.vx = direction(rng);
+    }
+    std::vector<Pose> poses(NB_OBJECTS), cache(NB_OBJECTS);
+
+    // orientations cached at creation
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < NB_OBJECTS; i++)
+    {
+        const Ecylinder &c = cylinders[i];
+        cache[i].rotation = PoseMath::axisOrientation(c.x2-c.x1, c.y2-c.y1, c.z2-c.z1).toRotationMatrix();
+        cache[i].translation = Vector3f((c.x1+c.x2)/2.f, (c.y1+c.y2)/2.f, (c.z1+c.z2)/2.f);
+    }
+    double creation = elapsed(start);
+
+    // every pose rebuilt at each frame
+    start = std::chrono::steady_clock::now();
+    for (unsigned int f = 0; f < NB_FRAMES; f++)
+        for (unsigned int i = 0; i < NB_OBJECTS; i++)
+            poses[i] = legacyPose(cylinders[i], f*FRAME_PERIOD);
+    double legacy = elapsed(start)/NB_FRAMES;
+
+    float error = 0.f;
+    for (unsigned int i = 0; i < NB_OBJECTS; i++)
+        error = std::max(error, (poses[i].rotation - cache[i].rotation).cwiseAbs().maxCoeff());
+
+    // cached orientations, only the moving cylinders are translated
+    start = std::chrono::steady_clock::now();
+    for (unsigned int f = 0; f < NB_FRAMES; f++)
+        for (unsigned int i = 0; i < NB_OBJECTS; i++)
+        {
+            if (cylinders[i].isStatic())
+                continue;
+            Epoint o = cylinders[i].displacement(f*FRAME_PERIOD);
+            poses[i].rotation = cache[i].rotation;
+            poses[i].translation = cache[i].translation + Vector3f(o.x, o.y, o.z);
+        }
+    double cached = elapsed(start)/NB_FRAMES;
+
+    // orientation of the drone from roll-pitch-yaw
+    volatile float sink = 0.f;
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < NB_OBJECTS; i++)
+    {
+        float a = i*1e-4f;
+        Matrix3f m = rotationMat(2.f*a, 2).cast<float>()*rotationMat(-a, 1).cast<float>()*rotationMat(a, 0).cast<float>();
+        sink = sink + m(0,0);
+    }
+    double legacyDrone = elapsed(start)/NB_OBJECTS;
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < NB_OBJECTS; i++)
+    {
+        float a = i*1e-4f;
+        Matrix3f m = PoseMath::rpyOrientation(a, a, 2.f*a).toRotationMatrix();
+        sink = sink + m(0,0);
+    }
+    double quaternionDrone = elapsed(start)/NB_OBJECTS;
+
+    cout << NB_OBJECTS << " cylinders, " << NB_OBJECTS/2 << " moving" << endl;
+    cout << "creation of the cached orientations: " << creation << " us" << endl;
+    cout << "per frame, rotation matrices:        " << legacy << " us" << endl;
+    cout << "per frame, cached orientations:      " << cached << " us" << endl;
+    cout << "largest difference of the rotations: " << error << endl;
+    cout << "drone orientation, rotation matrices: " << legacyDrone*1e3 << " ns, quaternion: " << quaternionDrone*1e3 << " ns" << endl;
+
+    return 0;
+}
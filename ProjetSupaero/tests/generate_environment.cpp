@@ -0,0 +1,182 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+// Generates large environments to stress the parser, the viewer and the solver:
+//   generate_environment <forest|urban|clutter> <number of cylinders> <seed> <output.xml>
+// The start position of the drone (0,0,4) and the goal (0,50,4) are kept free of obstacles.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "environmentparser.h"
+
+using std::cout; using std::endl;
+
+// Free space around the start and goal positions
+const Epoint START = {0.f, 0.f, 4.f};
+const Epoint GOAL = {0.f, 50.f, 4.f};
+const float CLEARANCE = 3.f;
+
+
+/**
+ * @brief distanceToSegment Distance between a point and the axis segment of a cylinder
+ */
+float distanceToSegment(const Epoint &p, const Ecylinder &c)
+{
+    float ax = c.x2-c.x1, ay = c.y2-c.y1, az = c.z2-c.z1;
+    float dx = p.x-c.x1, dy = p.y-c.y1, dz = p.z-c.z1;
+    float l2 = ax*ax+ay*ay+az*az;
+    float s = l2 > 0.f ? (dx*ax+dy*ay+dz*az)/l2 : 0.f;
+    s = std::min(1.f, std::max(0.f, s));
+    float ex = dx-s*ax, ey = dy-s*ay, ez = dz-s*az;
+    return sqrt(ex*ex+ey*ey+ez*ez);
+}
+
+/**
+ * @brief isClear Tells if a cylinder keeps the start and goal positions free
+ */
+bool isClear(const Ecylinder &c)
+{
+    return distanceToSegment(START, c) > c.radius + CLEARANCE && distanceToSegment(GOAL, c) > c.radius + CLEARANCE;
+}
+
+Ecylinder makeCylinder(float x1, float y1, float z1, float x2, float y2, float z2, float radius)
+{
+    Ecylinder c;
+    c.id = 0;
+    c.x1 = x1; c.y1 = y1; c.z1 = z1;
+    c.x2 = x2; c.y2 = y2; c.z2 = z2;
+    c.radius = radius;
+    c.vx = c.vy = c.vz = 0.f;
+    return c;
+}
+
+/**
+ * @brief forest Vertical poles at random positions, with a constant density around the start
+ */
+Ecylinder forest(std::mt19937 &rng, unsigned int count, unsigned int)
+{
+    float halfSize = 2.5f*sqrt((float)count);
+    std::uniform_real_distribution<float> position(-halfSize, halfSize);
+    std::uniform_real_distribution<float> radius(.2f, .6f);
+    std::uniform_real_distribution<float> height(5.f, 15.f);
+
+    float x = position(rng), y = position(rng);
+    return makeCylinder(x, y, 0.f, x, y, height(rng), radius(rng));
+}
+
+/**
+ * @brief urban Large towers on the blocks of a grid of streets, each tower on its own cell of the grid
+ */
+Ecylinder urban(std::mt19937 &rng, unsigned int count, unsigned int index)
+{
+    // blocks of 3x3 towers separated by streets, a few more cells than needed for the ones near the start and goal
+    const float spacing = 6.f;
+    int side = (int)ceil(sqrt(count*16./9.)) + 4;
+    int blockSide = (side/4)*3 + std::min(side%4, 3);
+    std::uniform_real_distribution<float> radius(1.f, 2.5f);
+    std::uniform_real_distribution<float> height(10.f, 40.f);
+
+    // index of the cell among the cells which are not streets, row by row
+    int row = index / blockSide, column = index % blockSide;
+    float x = ((row/3)*4 + row%3 - side/2)*spacing;
+    float y = ((column/3)*4 + column%3 - side/2)*spacing;
+
+    return makeCylinder(x, y, 0.f, x, y, height(rng), radius(rng));
+}
+
+/**
+ * @brief clutter Short cylinders with random orientations in a cube
+ */
+Ecylinder clutter(std::mt19937 &rng, unsigned int count, unsigned int)
+{
+    float halfSize = 2.f*cbrt((float)count);
+    std::uniform_real_distribution<float> position(-halfSize, halfSize);
+    std::uniform_real_distribution<float> direction(-1.f, 1.f);
+    std::uniform_real_distribution<float> length(1.f, 5.f);
+    std::uniform_real_distribution<float> radius(.1f, .5f);
+
+    float x = position(rng), y = position(rng), z = position(rng) + halfSize;
+    float dx = direction(rng), dy = direction(rng), dz = direction(rng);
+    float l = length(rng)/std::max(1e-3f, (float)sqrt(dx*dx+dy*dy+dz*dz));
+    return makeCylinder(x, y, z, x + l*dx, y + l*dy, z + l*dz, radius(rng));
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc != 5)
+    {
+        cout << "usage: " << argv[0] << " <forest|urban|clutter> <number of cylinders> <seed> <output.xml>" << endl;
+        return 1;
+    }
+
+    std::string pattern = argv[1];
+    unsigned int count = strtoul(argv[2], nullptr, 10);
+    std::mt19937 rng(strtoul(argv[3], nullptr, 10));
+    std::string output = argv[4];
+
+    Ecylinder (*generate)(std::mt19937 &, unsigned int, unsigned int);
+    if (pattern == "forest")
+        generate = forest;
+    else if (pattern == "urban")
+        generate = urban;
+    else if (pattern == "clutter")
+        generate = clutter;
+    else
+    {
+        cout << "unknown pattern " << pattern << endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // draw cylinders until enough of them keep the start and goal free
+    std::vector<Ecylinder> cylinders;
+    cylinders.reserve(count);
+    for (unsigned int attempt = 0; cylinders.size() < count; attempt++)
+    {
+        Ecylinder c = generate(rng, count, attempt);
+        if (!isClear(c))
+            continue;
+        c.id = cylinders.size()+1;
+        cylinders.push_back(c);
+    }
+
+    auto generated = std::chrono::steady_clock::now();
+
+    if (!EnvironmentParser::write(output, cylinders))
+        return 1;
+
+    auto written = std::chrono::steady_clock::now();
+
+    cout << count << " cylinders generated in "
+         << std::chrono::duration<double>(generated-start).count() << " s, written in "
+         << std::chrono::duration<double>(written-generated).count() << " s" << endl;
+
+    return 0;
+}
@@ -0,0 +1,676 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Runs batches of scenarios on worker processes, which may run on other hosts:
+//   scenario_runner coordinator <scenario file> [--port <port>] [--workers <n>] [--duration <s>] [--timeout <s>] [--output <file>]
+//   scenario_runner worker <host> [port]
+// Each line of the scenario file is "<environment file> <seed> <x> <y> <z> [<vx> <vy> <vz>]". The seed draws the speed
+// command and the gusts of wind of the flight. The coordinator sends one scenario at a time to each worker over TCP, and
+// streams the results to the output file as they come back. The scenario of a worker which disconnects, crashes or
+// times out is given to another worker, up to 3 attempts. --workers starts local workers on this host, and starts them
+// again when they crash. The environment files must be readable by the workers at the same path.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <acado_toolkit.hpp>
+#include <acado_optimal_control.hpp>
+
+#include "environment.h"
+#include "mpcsolver.h"
+#include "dronemodel.h"
+
+using std::cout; using std::endl;
+typedef std::chrono::steady_clock Clock;
+
+const char *DEFAULT_PORT = "7070";
+const double DEFAULT_DURATION = 20.;        // Simulated time of a scenario, in seconds
+const double STEP = 0.02;                   // Period of the MPC and of the simulation, as in the lockstep mode
+const double GUST_PERIOD = 1.;              // A gust changes the horizontal velocity every second
+const double GUST_DEVIATION = 0.3;          // Standard deviation of a gust, in m/s
+const unsigned int MAX_ATTEMPTS = 3;        // Attempts at a scenario before it is reported as crashed
+const unsigned int CONNECT_ATTEMPTS = 20;   // Attempts of a worker to reach the coordinator, every 0.5 s
+
+
+/**
+ * @brief The Scenario struct is a flight to simulate
+ */
+struct Scenario
+{
+    unsigned int id;                        // Index of the scenario among the ones of the file, from 0; the comments
+                                            // and the blank lines are not counted
+    std::string environment;
+    unsigned int seed;
+    double state[6];                        // Initial position and velocity
+    unsigned int attempts;
+};
+
+enum Status
+{
+    SUCCESS, COLLISION, NO_ENVIRONMENT, CRASHED
+};
+
+/**
+ * @brief The Result struct is the outcome of a scenario
+ */
+struct Result
+{
+    unsigned int id;
+    int status;
+    double position[3];                     // Final position
+    double minDistance;                     // Smallest distance to the surface of an obstacle
+    unsigned int nbSteps, nbFailures;       // MPC steps, and the ones which failed
+    double meanStepTime, maxStepTime;       // Duration of the MPC steps, in seconds
+};
+
+
+/**
+ * @brief sendLine Write a whole line to a socket
+ * @return false if the connection is lost
+ */
+bool sendLine(int fd, const std::string &line)
+{
+    std::string data = line + "\n";
+    for (size_t sent = 0; sent < data.size(); )
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+/**
+ * @brief receive Append the data available on a socket to a buffer
+ * @return false if the connection is closed
+ */
+bool receive(int fd, std::string &buffer)
+{
+    char chunk[4096];
+    ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0)
+        return false;
+    buffer.append(chunk, n);
+    return true;
+}
+
+/**
+ * @brief nextLine Take the first complete line out of a buffer
+ * @return false if the buffer holds no complete line
+ */
+bool nextLine(std::string &buffer, std::string &line)
+{
+    size_t end = buffer.find('\n');
+    if (end == std::string::npos)
+        return false;
+    line = buffer.substr(0, end);
+    buffer.erase(0, end+1);
+    return true;
+}
+
+void setNoDelay(int fd)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+
+// WORKER:
+// -------
+
+/**
+ * @brief simulate Fly a scenario in lockstep, with the speed command and the gusts drawn from its seed
+ * @param environment Environment of the last scenario, reused if the file is the same
+ */
+Result simulate(const Scenario &scenario, double duration, MPCSolver &mpc, ACADO::Process &process,
+                std::string &environmentFile, EnvironmentPtr &environment)
+{
+    USING_NAMESPACE_ACADO;
+
+    Result result = {scenario.id, SUCCESS, {0., 0., 0.}, std::numeric_limits<double>::infinity(), 0, 0, 0., 0.};
+    if (!environment || scenario.environment != environmentFile)
+    {
+        EnvironmentParser parser(scenario.environment);
+        environment = parser.isLoaded() ? parser.readEnvironment() : EnvironmentPtr();
+        environmentFile = scenario.environment;
+    }
+    if (!environment)
+    {
+        result.status = NO_ENVIRONMENT;
+        return result;
+    }
+    mpc.setObstacles(*environment);
+
+    std::mt19937 rng(scenario.seed);
+    std::uniform_real_distribution<double> heading(-M_PI, M_PI), speed(.5, 2.);
+    std::normal_distribution<double> gust(0., GUST_DEVIATION);
+    double psi = heading(rng), v = speed(rng);
+    double hover = DroneModel::hoverSpeed();
+    double refT[10] = {v*cos(psi), v*sin(psi), 0., hover, hover, hover, hover, 0., 0., 0.};
+    DVector refVec(MPCSolver::NB_OUTPUTS, refT);
+
+    // same initial state as ProjectSupaero, from the position and velocity of the scenario
+    DVector X(mpc.getNbStates()), U(MPCSolver::NB_CONTROLS);
+    X.setZero();
+    for (unsigned int i = 0; i < 6; i++)
+        X(i) = scenario.state[i];
+    if (mpc.getNbDroneStates() == MPCSolver::NB_STATES_QUATERNION)
+        X(6) = 1.;
+    for (unsigned int i = mpc.getNbDroneStates(); i < mpc.getNbStates(); i++)
+        X(i) = hover;
+    U.setZero();
+    mpc.init(0., X);
+    process.init(0., X, U);
+
+    VariablesGrid Y;
+    double totalStepTime = 0., nextGust = GUST_PERIOD;
+    for (double t = 0.; t < duration - STEP/2.; t += STEP)
+    {
+        mpc.setReference(VariablesGrid(refVec, Grid{t, t+1., 2}));
+        auto start = Clock::now();
+        bool success = mpc.step(t, X);
+        double stepTime = std::chrono::duration<double>(Clock::now() - start).count();
+        totalStepTime += stepTime;
+        result.maxStepTime = std::max(result.maxStepTime, stepTime);
+        result.nbSteps++;
+
+        // the constraints are soft, a failure is numerical: the last command is kept
+        if (success)
+            mpc.getU(U);
+        else
+            result.nbFailures++;
+
+        process.step(t, t+STEP, U);
+        process.getY(Y);
+        X = Y.getLastVector();
+
+        // a gust changes the velocity, the simulation starts again from the new state
+        if (t+STEP >= nextGust)
+        {
+            X(3) += gust(rng);
+            X(4) += gust(rng);
+            process.init(t+STEP, X, U);
+            nextGust += GUST_PERIOD;
+        }
+
+        double distance = mpc.getObstacleDistance(t+STEP, X);
+        result.minDistance = std::min(result.minDistance, distance);
+        if (distance < 0.)
+            result.status = COLLISION;
+    }
+
+    for (unsigned int i = 0; i < 3; i++)
+        result.position[i] = X(i);
+    result.meanStepTime = result.nbSteps > 0 ? totalStepTime/result.nbSteps : 0.;
+    return result;
+}
+
+/**
+ * @brief connectTo Connect to the coordinator, which may not listen yet
+ * @return the socket, -1 on failure
+ */
+int connectTo(const char *host, const char *port)
+{
+    addrinfo hints, *addresses;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &addresses) != 0)
+    {
+        std::cout << "Error: unknown host " << host << std::endl;
+        return -1;
+    }
+
+    int fd = -1;
+    for (unsigned int attempt = 0; attempt < CONNECT_ATTEMPTS && fd < 0; attempt++)
+    {
+        if (attempt > 0)
+            usleep(500000);
+        for (addrinfo *a = addresses; a && fd < 0; a = a->ai_next)
+        {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+            {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0)
+        std::cout << "Error: cannot connect to " << host << ":" << port << std::endl;
+    else
+        setNoDelay(fd);
+    return fd;
+}
+
+/**
+ * @brief runWorker Simulate the scenarios sent by a coordinator until it sends QUIT or disconnects
+ */
+int runWorker(const char *host, const char *port)
+{
+    USING_NAMESPACE_ACADO;
+
+    int fd = connectTo(host, port);
+    if (fd < 0)
+        return 1;
+
+    char hostname[256] = "unknown";
+    gethostname(hostname, sizeof(hostname)-1);
+    std::ostringstream hello;
+    hello << "HELLO " << hostname << ":" << getpid();
+    if (!sendLine(fd, hello.str()))
+        return 1;
+
+    // one solver and one simulation for all the scenarios, only the obstacles change
+    MPCSolver mpc((MPCParameters()));
+    DynamicSystem dynamicSystem(mpc.getModel(), OutputFcn{});
+    Process process(dynamicSystem, INT_RK45);
+    std::string environmentFile;
+    EnvironmentPtr environment;
+
+    std::string buffer, line;
+    while (true)
+    {
+        while (!nextLine(buffer, line))
+        {
+            if (!receive(fd, buffer))
+            {
+                close(fd);
+                return 0;
+            }
+        }
+
+        std::istringstream message(line);
+        std::string command;
+        message >> command;
+        if (command == "QUIT")
+            break;
+        if (command != "RUN")
+            continue;
+
+        // RUN <id> <seed> <duration> <x> <y> <z> <vx> <vy> <vz> <environment file>
+        Scenario scenario;
+        double duration;
+        message >> scenario.id >> scenario.seed >> duration;
+        for (unsigned int i = 0; i < 6; i++)
+            message >> scenario.state[i];
+        message >> std::ws;
+        std::getline(message, scenario.environment);
+
+        Result r = simulate(scenario, duration, mpc, process, environmentFile, environment);
+        std::ostringstream reply;
+        reply << std::setprecision(17) << "RESULT " << r.id << " " << r.status << " " << r.position[0] << " " << r.position[1]
+              << " " << r.position[2] << " " << r.minDistance << " " << r.nbSteps << " " << r.nbFailures << " "
+              << r.meanStepTime << " " << r.maxStepTime;
+        if (!sendLine(fd, reply.str()))
+            break;
+    }
+    close(fd);
+    return 0;
+}
+
+
+// COORDINATOR:
+// ------------
+
+/**
+ * @brief The Worker struct is the connection of the coordinator to a worker
+ */
+struct Worker
+{
+    int fd;
+    std::string name;                       // Host and pid of the worker, known once it said HELLO
+    pid_t pid;                              // Pid of the worker, if it is a local worker
+    std::string input;                      // Received data not processed yet
+    bool busy;
+    Scenario scenario;                      // Scenario of a busy worker
+    Clock::time_point deadline;
+};
+
+/**
+ * @brief readScenarios Parse a scenario file
+ * @return false if a line is malformed
+ */
+bool readScenarios(const char *filename, std::deque<Scenario> &scenarios)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        std::cout << "Error: cannot read " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (unsigned int n = 1; std::getline(file, line); n++)
+    {
+        std::istringstream fields(line);
+        Scenario s = {(unsigned int)scenarios.size(), "", 0, {0., 0., 0., 0., 0., 0.}, 0};
+        if (!(fields >> s.environment) || s.environment[0] == '#')
+            continue;
+        if (!(fields >> s.seed >> s.state[0] >> s.state[1] >> s.state[2]))
+        {
+            std::cout << "Error: line " << n << " of " << filename << " is not <environment file> <seed> <x> <y> <z> [<vx> <vy> <vz>]" << std::endl;
+            return false;
+        }
+        fields >> s.state[3] >> s.state[4] >> s.state[5];
+        scenarios.push_back(s);
+    }
+    return true;
+}
+
+/**
+ * @brief listenOn Open the socket of the coordinator on every interface
+ * @return the socket, -1 on failure
+ */
+int listenOn(const char *port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(atoi(port));
+    if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 64) != 0)
+    {
+        std::cout << "Error: cannot listen on port " << port << std::endl;
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int runCoordinator(int argc, char *argv[])
+{
+    const char *port = DEFAULT_PORT, *output = nullptr;
+    unsigned int nbLocalWorkers = 0;
+    double duration = DEFAULT_DURATION, timeout = 0.;
+    for (int i = 3; i+1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--port") == 0)
+            port = argv[i+1];
+        else if (std::strcmp(argv[i], "--workers") == 0)
+            nbLocalWorkers = strtoul(argv[i+1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--duration") == 0)
+            duration = atof(argv[i+1]);
+        else if (std::strcmp(argv[i], "--timeout") == 0)
+            timeout = atof(argv[i+1]);
+        else if (std::strcmp(argv[i], "--output") == 0)
+            output = argv[i+1];
+    }
+    // a worker stuck in a scenario is given up, by default after ten times the simulated time and at least a minute
+    if (timeout <= 0.)
+        timeout = std::max(60., 10.*duration);
+
+    std::deque<Scenario> queue;
+    if (!readScenarios(argv[2], queue))
+        return 1;
+    const unsigned int nbScenarios = queue.size();
+
+    std::ofstream file;
+    if (output)
+    {
+        file.open(output);
+        if (!file)
+        {
+            std::cout << "Error: cannot write " << output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &results = output ? file : cout;
+    results << "# id status x y z min_distance steps failed_steps mean_step_ms max_step_ms worker" << endl;
+
+    int listener = listenOn(port);
+    if (listener < 0)
+        return 1;
+
+    // build the problem before forking the local workers, which copy it instead of building their own
+    std::unique_ptr<MPCSolver> prototype;
+    if (nbLocalWorkers > 0)
+        prototype.reset(new MPCSolver(MPCParameters()));
+    std::vector<Worker> workers;
+    std::vector<pid_t> localWorkers;
+    auto spawnLocalWorkers = [&]()
+    {
+        while (localWorkers.size() < std::min<size_t>(nbLocalWorkers, queue.size()))
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                // a stuck worker must see its connection close when the coordinator gives it up
+                close(listener);
+                for (const Worker &w : workers)
+                    close(w.fd);
+                _exit(runWorker("127.0.0.1", port));
+            }
+            if (pid < 0)
+                break;
+            localWorkers.push_back(pid);
+        }
+    };
+
+    const char *statuses[] = {"success", "collision", "no_environment", "crashed"};
+    unsigned int nbDone = 0, nbRequeued = 0, counts[4] = {0, 0, 0, 0};
+    unsigned long nbSteps = 0, nbFailures = 0;
+    double totalStepTime = 0., maxStepTime = 0., minDistance = std::numeric_limits<double>::infinity();
+    auto record = [&](const Result &r, const std::string &worker)
+    {
+        results << r.id << " " << statuses[r.status] << " " << r.position[0] << " " << r.position[1] << " "
+                << r.position[2] << " " << r.minDistance << " " << r.nbSteps << " " << r.nbFailures << " "
+                << r.meanStepTime*1000. << " " << r.maxStepTime*1000. << " " << worker << endl;
+        counts[r.status]++;
+        nbSteps += r.nbSteps;
+        nbFailures += r.nbFailures;
+        totalStepTime += r.meanStepTime*r.nbSteps;
+        maxStepTime = std::max(maxStepTime, r.maxStepTime);
+        if (r.status == SUCCESS || r.status == COLLISION)
+            minDistance = std::min(minDistance, r.minDistance);
+        nbDone++;
+    };
+
+    // the scenario of a lost worker goes back to the front of the queue, until it has crashed too many workers. A local
+    // worker which timed out is killed, and started again.
+    auto drop = [&](Worker &w, const char *reason)
+    {
+        if (w.busy)
+        {
+            Scenario s = w.scenario;
+            s.attempts++;
+            cout << "worker " << w.name << " " << reason << " during scenario " << s.id << ", attempt " << s.attempts << endl;
+            if (s.attempts < MAX_ATTEMPTS)
+            {
+                queue.push_front(s);
+                nbRequeued++;
+            }
+            else
+                record({s.id, CRASHED, {0., 0., 0.}, 0., 0, 0, 0., 0.}, w.name);
+        }
+        if (std::find(localWorkers.begin(), localWorkers.end(), w.pid) != localWorkers.end())
+            kill(w.pid, SIGKILL);
+        close(w.fd);
+        w.fd = -1;
+        w.busy = false;
+    };
+
+    char hostname[256] = "unknown";
+    gethostname(hostname, sizeof(hostname)-1);
+    auto start = Clock::now();
+    signal(SIGPIPE, SIG_IGN);
+    spawnLocalWorkers();
+    cout << nbScenarios << " scenarios, listening on port " << port << endl;
+
+    while (nbDone < nbScenarios)
+    {
+        // start the local workers again when they crash, as long as there is work for them
+        pid_t pid;
+        while ((pid = waitpid(-1, nullptr, WNOHANG)) > 0)
+            localWorkers.erase(std::remove(localWorkers.begin(), localWorkers.end(), pid), localWorkers.end());
+        spawnLocalWorkers();
+
+        // give a scenario to each idle worker
+        Clock::time_point now = Clock::now();
+        for (Worker &w : workers)
+        {
+            if (w.fd < 0 || w.busy || w.name.empty() || queue.empty())
+                continue;
+            Scenario &s = queue.front();
+            std::ostringstream run;
+            run << std::setprecision(17) << "RUN " << s.id << " " << s.seed << " " << duration;
+            for (unsigned int i = 0; i < 6; i++)
+                run << " " << s.state[i];
+            run << " " << s.environment;
+            w.busy = true;
+            w.scenario = s;
+            w.deadline = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+            queue.pop_front();
+            if (!sendLine(w.fd, run.str()))
+                drop(w, "disconnected");
+        }
+        workers.erase(std::remove_if(workers.begin(), workers.end(), [](const Worker &w) { return w.fd < 0; }), workers.end());
+
+        // wait for a connection or a message, at most until the next deadline and 1 s to reap the local workers
+        std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+        double wait = 1.;
+        for (const Worker &w : workers)
+        {
+            fds.push_back({w.fd, POLLIN, 0});
+            if (w.busy)
+                wait = std::min(wait, std::chrono::duration<double>(w.deadline - now).count());
+        }
+        poll(fds.data(), fds.size(), std::max(0, (int)(wait*1000.)));
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0)
+            {
+                setNoDelay(fd);
+                workers.push_back({fd, "", 0, "", false, Scenario(), Clock::time_point()});
+            }
+        }
+
+        now = Clock::now();
+        for (unsigned int i = 1; i < fds.size(); i++)
+        {
+            Worker &w = workers[i-1];
+            if (fds[i].revents != 0 && !receive(w.fd, w.input))
+            {
+                drop(w, w.name.empty() ? "disconnected" : "crashed");
+                continue;
+            }
+
+            std::string line;
+            while (nextLine(w.input, line))
+            {
+                std::istringstream message(line);
+                std::string command;
+                message >> command;
+                if (command == "HELLO")
+                {
+                    message >> w.name;
+                    size_t colon = w.name.rfind(':');
+                    if (colon != std::string::npos && w.name.substr(0, colon) == hostname)
+                        w.pid = atoi(w.name.substr(colon+1).c_str());
+                    cout << "worker " << w.name << " connected" << endl;
+                }
+                else if (command == "RESULT" && w.busy)
+                {
+                    Result r;
+                    message >> r.id >> r.status >> r.position[0] >> r.position[1] >> r.position[2] >> r.minDistance
+                            >> r.nbSteps >> r.nbFailures >> r.meanStepTime >> r.maxStepTime;
+                    if (message && r.id == w.scenario.id && r.status >= SUCCESS && r.status < CRASHED)
+                    {
+                        record(r, w.name);
+                        w.busy = false;
+                    }
+                }
+            }
+
+            if (w.busy && now > w.deadline)
+                drop(w, "timed out");
+        }
+    }
+
+    // the workers are done
+    for (Worker &w : workers)
+    {
+        if (w.fd >= 0)
+        {
+            sendLine(w.fd, "QUIT");
+            close(w.fd);
+        }
+    }
+    close(listener);
+    // local workers started late may still be trying to connect
+    for (pid_t pid : localWorkers)
+        kill(pid, SIGTERM);
+    while (wait(nullptr) > 0);
+
+    double wallTime = std::chrono::duration<double>(Clock::now() - start).count();
+    cout << nbScenarios << " scenarios in " << wallTime << " s (" << nbScenarios/wallTime << " per second), "
+         << nbRequeued << " re-queued" << endl;
+    for (unsigned int i = 0; i < 4; i++)
+        cout << "  " << statuses[i] << ": " << counts[i] << endl;
+    cout << "MPC steps: " << nbSteps << ", " << nbFailures << " failed, mean " << (nbSteps > 0 ? totalStepTime/nbSteps*1000. : 0.)
+         << " ms, max " << maxStepTime*1000. << " ms" << endl;
+    cout << "smallest distance to an obstacle: " << minDistance << " m" << endl;
+    return counts[CRASHED] > 0 ? 2 : 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && std::strcmp(argv[1], "coordinator") == 0)
+        return runCoordinator(argc, argv);
+    if (argc >= 3 && std::strcmp(argv[1], "worker") == 0)
+        return runWorker(argv[2], argc > 3 ? argv[3] : DEFAULT_PORT);
+
+    cout << "usage: " << argv[0] << " coordinator <scenario file> [--port <port>] [--workers <n>] [--duration <s>] [--timeout <s>] [--output <file>]" << endl
+         << "       " << argv[0] << " worker <host> [port]" << endl;
+    return 1;
+}
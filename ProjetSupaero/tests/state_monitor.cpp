@@ -0,0 +1,87 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Reads the state published by ProjectSupaero in shared memory, without slowing the control loop down:
+//   state_monitor            prints the last record 10 times per second
+//   state_monitor --log      prints every record as a line of CSV, for a logger
+
+#include <iostream>
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+
+#include "sharedstate.h"
+
+using std::cout; using std::endl;
+
+const char *SHARED_STATE = "/ProjectSupaero";
+const char *STATUS[] = {"ok", "failed", "skipped", "played back"};
+const char *TRIGGER[] = {"none", "start", "deviation", "reference", "obstacle", "expired", "failed"};
+
+int main(int argc, char *argv[])
+{
+    bool log = argc > 1 && std::strcmp(argv[1], "--log") == 0;
+
+    std::unique_ptr<SharedStateReader> reader(new SharedStateReader(SHARED_STATE));
+    while (!reader->isOpen())
+    {
+        cout << "waiting for " << SHARED_STATE << endl;
+        sleep(1);
+        reader.reset(new SharedStateReader(SHARED_STATE));
+    }
+
+    SharedStateRecord record;
+    if (log)
+    {
+        cout << "index,t,solver,solve time,solves,trigger,obstacle slack,attitude slack,x,y,z,vx,vy,vz,u1,u2,u3,u4" << endl;
+        while (true)
+        {
+            while (reader->next(record))
+            {
+                cout << record.index << "," << record.t << "," << STATUS[record.solverStatus] << "," << record.solveTime
+                     << "," << record.nbSolves << "," << TRIGGER[record.trigger]
+                     << "," << record.obstacleSlack << "," << record.attitudeSlack;
+                for (int i = 0; i < 6; i++)
+                    cout << "," << record.state[i];
+                for (int i = 0; i < 4; i++)
+                    cout << "," << record.controls[i];
+                cout << "\n";
+            }
+            cout.flush();
+            usleep(10000);
+        }
+    }
+
+    while (true)
+    {
+        if (reader->latest(record))
+            cout << "t " << record.t << "  position " << record.state[0] << " " << record.state[1] << " " << record.state[2]
+                 << "  velocity " << record.state[3] << " " << record.state[4] << " " << record.state[5]
+                 << "  solver " << STATUS[record.solverStatus] << " " << record.solveTime*1e3 << " ms"
+                 << "  solves " << record.nbSolves << " (" << TRIGGER[record.trigger] << ")"
+                 << "  slack " << record.obstacleSlack << " " << record.attitudeSlack << endl;
+        usleep(100000);
+    }
+
+    return 0;
+}
@@ -24,7 +24,7 @@ along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "gepetto/viewer/corba/client.hh"
 #include "viewer.h"
-#include "environmentparser.h"
+#include "environment.h"
 
 // Demonstration d'affichage de l'environnement a partir d'un fichier xml
 
@@ -53,9 +53,9 @@ int main( ){
 
     // Chargement de l'environnement
     EnvironmentParser g(a);
-    std::vector<Ecylinder> cylinder_list=g.readData();
+    EnvironmentPtr environment=g.readEnvironment();
 
-    viewer.createEnvironment(cylinder_list);
+    viewer.createEnvironment(*environment);
 
     return 0;
 }
@@ -0,0 +1,77 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+
+// Splits an environment into square tiles, to be streamed by ProjectSupaero --tiles:
+//   tile_environment <environment.xml> <output directory> [tile size, 50 by default]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "environmentparser.h"
+#include "tiledenvironment.h"
+
+using std::cout; using std::endl;
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3 && argc != 4)
+    {
+        cout << "usage: " << argv[0] << " <environment.xml> <output directory> [tile size]" << endl;
+        return 1;
+    }
+
+    float tileSize = argc == 4 ? std::atof(argv[3]) : 50.f;
+    if (tileSize <= 0.f)
+    {
+        cout << "the tile size must be positive" << endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    EnvironmentParser parser(argv[1]);
+    if (!parser.isLoaded())
+    {
+        cout << "cannot load " << argv[1] << endl;
+        return 1;
+    }
+    std::vector<Ecylinder> cylinders = parser.readData();
+
+    auto read = std::chrono::steady_clock::now();
+
+    if (!TiledEnvironment::build(cylinders, argv[2], tileSize))
+    {
+        cout << "cannot write the tiles to " << argv[2] << endl;
+        return 1;
+    }
+
+    auto written = std::chrono::steady_clock::now();
+
+    cout << cylinders.size() << " cylinders read in " << std::chrono::duration<double>(read-start).count()
+         << " s, tiles written in " << std::chrono::duration<double>(written-read).count() << " s" << endl;
+
+    return 0;
+}
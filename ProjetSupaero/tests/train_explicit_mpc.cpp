@@ -0,0 +1,327 @@
+/**************************************************************************
+Copyright 2016 Yoan BAILLAU, Thibault BARBIÉ, Zhengxuan JIA,
+   Francisco PEDROSA-REIS, William RAKOTOMANGA, Baudouin ROULLIER
+
+This file is part of ProjectSupaero.
+
+ProjectSupaero is free software: you can redistribute it and/or modify
+it under the terms of the lesser GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+ProjectSupaero is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+lesser GNU General Public License for more details.
+
+You should have received a copy of the lesser GNU General Public License
+along with ProjectSupaero.  If not, see <http://www.gnu.org/licenses/>.
+
+**************************************************************************/
+
+
+// Learns an explicit approximation of the MPC, used by ExplicitController:
+//   train_explicit_mpc <output file> [number of samples] [number of workers]
+// States and speed references are sampled around hover, far from any obstacle, and solved by worker processes (ACADO
+// is not thread-safe). A small network is then fitted on the commands of the MPC.
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include <acado_toolkit.hpp>
+#include <acado_optimal_control.hpp>
+
+#include "mpcsolver.h"
+#include "dronemodel.h"
+#include "explicitcontroller.h"
+
+using std::cout; using std::endl;
+using Eigen::MatrixXd;
+using Eigen::VectorXd;
+
+const unsigned int NB_ITERATIONS = 10;      // Real-time iterations on each sample, to converge
+const unsigned int SAMPLE_SIZE = ExplicitController::NB_INPUTS + ExplicitController::NB_OUTPUTS;
+const unsigned int NB_EPOCHS = 300;
+const unsigned int BATCH_SIZE = 128;
+const double LEARNING_RATE = 1e-3;
+
+
+/**
+ * @brief drawSample Draw a state around hover and a speed reference. Each sample has its own seed, so that the data
+ * set does not depend on the number of workers.
+ */
+void drawSample(unsigned int index, std::array<double,12> &state, std::array<double,3> &reference)
+{
+    std::mt19937 rng(index);
+    std::uniform_real_distribution<double> velocity(-3., 3.), yaw(-M_PI, M_PI), angle(-.5, .5), rate(-1., 1.), speed(-2., 2.);
+
+    state = {0., 0., 4., velocity(rng), velocity(rng), velocity(rng), yaw(rng), angle(rng), angle(rng), rate(rng), rate(rng), rate(rng)};
+    reference = {speed(rng), speed(rng), speed(rng)};
+}
+
+/**
+ * @brief solveSamples Solve the samples of one worker and write the inputs and outputs of the network to a pipe
+ */
+void solveSamples(unsigned int worker, unsigned int nbWorkers, unsigned int nbSamples, int fd)
+{
+    USING_NAMESPACE_ACADO;
+
+    MPCParameters parameters;
+    MPCSolver mpc(parameters);
+    DVector X(MPCSolver::NB_STATES), U(MPCSolver::NB_CONTROLS), refVec(MPCSolver::NB_OUTPUTS);
+    double hover = DroneModel::hoverSpeed();
+
+    for (unsigned int i = worker; i < nbSamples; i += nbWorkers)
+    {
+        std::array<double,12> state;
+        std::array<double,3> reference;
+        drawSample(i, state, reference);
+
+        for (unsigned int k = 0; k < MPCSolver::NB_STATES; k++)
+            X(k) = state[k];
+        double refT[10] = {reference[0], reference[1], reference[2], hover, hover, hover, hover, 0., 0., 0.};
+        refVec = DVector(MPCSolver::NB_OUTPUTS, refT);
+        mpc.setReference(VariablesGrid(refVec, Grid{0., 1., 2}));
+
+        // iterate on the same state until the real-time iteration converges
+        mpc.init(0., X);
+        bool success = true;
+        for (unsigned int k = 0; k < NB_ITERATIONS && success; k++)
+            success = mpc.step(0., X);
+        if (!success)
+            continue;
+        mpc.getU(U);
+
+        double sample[SAMPLE_SIZE];
+        for (int k = 0; k < 9; k++)
+            sample[k] = state[k+3];
+        for (int k = 0; k < 3; k++)
+            sample[9+k] = reference[k];
+        for (int k = 0; k < 4; k++)
+            sample[12+k] = U(k);
+        if (write(fd, sample, sizeof(sample)) != sizeof(sample))
+            break;
+    }
+}
+
+/**
+ * @brief collectSamples Run the workers and gather their samples, one column per sample
+ */
+MatrixXd collectSamples(unsigned int nbSamples, unsigned int nbWorkers)
+{
+    // build the problem once, the workers inherit it and copy it instead of building their own
+    MPCSolver prototype((MPCParameters()));
+
+    std::vector<pollfd> pipes;
+    for (unsigned int w = 0; w < nbWorkers; w++)
+    {
+        int fd[2];
+        if (pipe(fd) != 0)
+            break;
+
+        if (fork() == 0)
+        {
+            close(fd[0]);
+            solveSamples(w, nbWorkers, nbSamples, fd[1]);
+            close(fd[1]);
+            _exit(0);
+        }
+        close(fd[1]);
+        pipes.push_back({fd[0], POLLIN, 0});
+    }
+
+    // read the pipes as the samples arrive, a crashed worker only loses its remaining samples
+    std::vector<double> data;
+    std::vector<std::vector<char> > pending(pipes.size());
+    unsigned int nbOpen = pipes.size();
+    while (nbOpen > 0)
+    {
+        poll(pipes.data(), pipes.size(), -1);
+        for (unsigned int w = 0; w < pipes.size(); w++)
+        {
+            if (pipes[w].fd < 0 || pipes[w].revents == 0)
+                continue;
+
+            char chunk[4096];
+            ssize_t n = read(pipes[w].fd, chunk, sizeof(chunk));
+            if (n <= 0)
+            {
+                close(pipes[w].fd);
+                pipes[w].fd = -1;
+                nbOpen--;
+                continue;
+            }
+
+            // samples may be split between reads
+            pending[w].insert(pending[w].end(), chunk, chunk + n);
+            size_t complete = pending[w].size() - pending[w].size()%(SAMPLE_SIZE*sizeof(double));
+            const double *samples = (const double *)pending[w].data();
+            data.insert(data.end(), samples, samples + complete/sizeof(double));
+            pending[w].erase(pending[w].begin(), pending[w].begin() + complete);
+        }
+    }
+    while (wait(nullptr) > 0);
+
+    return Eigen::Map<MatrixXd>(data.data(), SAMPLE_SIZE, data.size()/SAMPLE_SIZE);
+}
+
+
+/**
+ * @brief The Layer struct holds the weights of a layer and the moments of the Adam optimiser
+ */
+struct Layer
+{
+    MatrixXd W, mW, vW;
+    VectorXd b, mb, vb;
+
+    Layer(int nbOutputs, int nbInputs, std::mt19937 &rng)
+    {
+        std::normal_distribution<double> init(0., sqrt(1./nbInputs));
+        W = MatrixXd::NullaryExpr(nbOutputs, nbInputs, [&]() { return init(rng); });
+        b = VectorXd::Zero(nbOutputs);
+        mW = vW = MatrixXd::Zero(nbOutputs, nbInputs);
+        mb = vb = VectorXd::Zero(nbOutputs);
+    }
+
+    void update(const MatrixXd &gW, const VectorXd &gb, int step)
+    {
+        const double beta1 = .9, beta2 = .999, epsilon = 1e-8;
+        double c1 = 1. - pow(beta1, step), c2 = 1. - pow(beta2, step);
+        mW = beta1*mW + (1.-beta1)*gW;
+        vW = beta2*vW + (1.-beta2)*gW.cwiseAbs2();
+        mb = beta1*mb + (1.-beta1)*gb;
+        vb = beta2*vb + (1.-beta2)*gb.cwiseAbs2();
+        W -= LEARNING_RATE*((mW/c1).array()/((vW/c2).array().sqrt() + epsilon)).matrix();
+        b -= LEARNING_RATE*((mb/c1).array()/((vb/c2).array().sqrt() + epsilon)).matrix();
+    }
+};
+
+/**
+ * @brief rmse Root mean square error of the network on normalised samples, in the unit of the outputs
+ */
+double rmse(Layer &l1, Layer &l2, Layer &l3, const MatrixXd &X, const MatrixXd &Y, const VectorXd &outputScale)
+{
+    MatrixXd H1 = ((l1.W*X).colwise() + l1.b).array().tanh();
+    MatrixXd H2 = ((l2.W*H1).colwise() + l2.b).array().tanh();
+    MatrixXd E = ((l3.W*H2).colwise() + l3.b) - Y;
+    E = outputScale.asDiagonal()*E;
+    return sqrt(E.squaredNorm()/E.size());
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cout << "usage: " << argv[0] << " <output file> [number of samples] [number of workers]" << endl;
+        return 1;
+    }
+    unsigned int nbSamples = argc > 2 ? strtoul(argv[2], nullptr, 10) : 5000;
+    unsigned int nbWorkers = argc > 3 ? strtoul(argv[3], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+
+    // SOLVE THE SAMPLES:
+    // ------------------
+    auto start = std::chrono::steady_clock::now();
+    MatrixXd data = collectSamples(nbSamples, nbWorkers);
+    cout << data.cols() << " samples solved by " << nbWorkers << " workers in "
+         << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << endl;
+    if (data.cols() < 2*BATCH_SIZE)
+    {
+        cout << "not enough samples" << endl;
+        return 1;
+    }
+
+    // normalise inputs and outputs
+    const int nI = ExplicitController::NB_INPUTS, nO = ExplicitController::NB_OUTPUTS, nH = ExplicitController::NB_HIDDEN;
+    VectorXd mean = data.rowwise().mean();
+    VectorXd scale = ((data.colwise() - mean).cwiseAbs2().rowwise().mean()).cwiseSqrt().cwiseMax(1e-6);
+    MatrixXd normalised = scale.cwiseInverse().asDiagonal()*(data.colwise() - mean);
+
+    // keep 10% of the samples for validation
+    int nbValidation = data.cols()/10, nbTraining = data.cols() - nbValidation;
+    MatrixXd Xt = normalised.topLeftCorner(nI, nbTraining), Yt = normalised.bottomLeftCorner(nO, nbTraining);
+    MatrixXd Xv = normalised.topRightCorner(nI, nbValidation), Yv = normalised.bottomRightCorner(nO, nbValidation);
+    VectorXd outputScale = scale.tail(nO);
+
+    // TRAIN THE NETWORK:
+    // ------------------
+    std::mt19937 rng(0);
+    Layer l1(nH, nI, rng), l2(nH, nH, rng), l3(nO, nH, rng);
+    std::vector<int> order(nbTraining);
+    for (int i = 0; i < nbTraining; i++)
+        order[i] = i;
+
+    int step = 0;
+    for (unsigned int epoch = 0; epoch < NB_EPOCHS; epoch++)
+    {
+        std::shuffle(order.begin(), order.end(), rng);
+        for (int first = 0; first + (int)BATCH_SIZE <= nbTraining; first += BATCH_SIZE)
+        {
+            MatrixXd X(nI, BATCH_SIZE), Y(nO, BATCH_SIZE);
+            for (unsigned int k = 0; k < BATCH_SIZE; k++)
+            {
+                X.col(k) = Xt.col(order[first+k]);
+                Y.col(k) = Yt.col(order[first+k]);
+            }
+
+            // forward and backward pass on the mean squared error
+            MatrixXd H1 = ((l1.W*X).colwise() + l1.b).array().tanh();
+            MatrixXd H2 = ((l2.W*H1).colwise() + l2.b).array().tanh();
+            MatrixXd dY = (((l3.W*H2).colwise() + l3.b) - Y)*(2./BATCH_SIZE);
+            MatrixXd dZ2 = (l3.W.transpose()*dY).cwiseProduct((1. - H2.array().square()).matrix());
+            MatrixXd dZ1 = (l2.W.transpose()*dZ2).cwiseProduct((1. - H1.array().square()).matrix());
+
+            step++;
+            l3.update(dY*H2.transpose(), dY.rowwise().sum(), step);
+            l2.update(dZ2*H1.transpose(), dZ2.rowwise().sum(), step);
+            l1.update(dZ1*X.transpose(), dZ1.rowwise().sum(), step);
+        }
+
+        if (epoch%50 == 0 || epoch+1 == NB_EPOCHS)
+            cout << "epoch " << epoch << ": training error " << rmse(l1, l2, l3, Xt, Yt, outputScale)
+                 << ", validation error " << rmse(l1, l2, l3, Xv, Yv, outputScale) << " (propeller velocity)" << endl;
+    }
+
+    // SAVE AND TIME THE CONTROLLER:
+    // -----------------------------
+    ExplicitController::Network network;
+    network.W1 = l1.W.cast<float>();
+    network.b1 = l1.b.cast<float>();
+    network.W2 = l2.W.cast<float>();
+    network.b2 = l2.b.cast<float>();
+    network.W3 = l3.W.cast<float>();
+    network.b3 = l3.b.cast<float>();
+    network.inputMean = mean.head(nI).cast<float>();
+    network.inputScale = scale.head(nI).cast<float>();
+    network.outputMean = mean.tail(nO).cast<float>();
+    network.outputScale = outputScale.cast<float>();
+
+    ExplicitController controller(network);
+    if (!controller.save(argv[1]))
+        return 1;
+
+    const int nbEvaluations = 100000;
+    std::array<double,12> state;
+    std::array<double,3> reference;
+    double checksum = 0.;
+    drawSample(0, state, reference);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nbEvaluations; i++)
+    {
+        state[3] = 1e-6*i;
+        checksum += controller.evaluate(state, reference)[0];
+    }
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    cout << "evaluation time: " << elapsed/nbEvaluations << " us (checksum " << checksum << ")" << endl;
+
+    return 0;
+}